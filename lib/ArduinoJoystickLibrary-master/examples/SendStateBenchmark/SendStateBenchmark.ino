@@ -0,0 +1,214 @@
+// Cycle counts for building a joystick report on the Arduino Leonardo or
+// Arduino Micro. Compares the per-value conversion the library used to do
+// (clamp, invert and map() into 0..65535) with the precomputed
+// JoystickAxisScale, then times a full report update with every axis and
+// simulator control enabled: setting all 11 values and calling sendState(),
+// against the map()-based sendState() the library had before, reproduced
+// below. The USB transfer is left out of both: the old sendState() stands
+// in a copy of the report for it, and the current one is timed on an
+// unchanged report after an untimed send.
+// Timed with Timer1 the same way as FUTABA_SBUS's channel_unpack_bench.
+//------------------------------------------------------------
+
+#include "Joystick.h"
+
+#define BENCH_RUNS 256
+#define BENCH_VALUES 11
+#define LEGACY_BUTTON_BYTES 4  // JOYSTICK_DEFAULT_BUTTON_COUNT / 8
+#define LEGACY_REPORT_SIZE (LEGACY_BUTTON_BYTES + 1 + 2 * BENCH_VALUES) // buttons, hat switches, values
+
+Joystick_ Joystick;
+
+JoystickAxisScale scales[BENCH_VALUES] = {
+  {0, 1023}, {0, 1023}, {0, 1023}, {0, 1023}, {0, 1023}, {0, 1023},
+  {172, 1811}, {1811, 172}, {0, 1023}, {1023, 0}, {-512, 511}
+};
+int32_t values[BENCH_VALUES];
+volatile uint16_t sink;
+
+uint16_t cyclesMap;
+uint16_t cyclesScale;
+uint16_t cyclesSetValues;
+uint16_t cyclesSendState;
+uint16_t cyclesLegacySendState;
+
+// State the old Joystick_ kept: raw values, converted on every sendState()
+int32_t legacyValues[BENCH_VALUES];
+uint8_t legacyButtons[LEGACY_BUTTON_BYTES];
+int16_t legacyHatSwitch[2] = { -1, -1 };
+uint8_t legacyReport[LEGACY_REPORT_SIZE];
+bool legacyReportValid;
+
+// The conversion buildAndSet16BitValue() did before the scale was precomputed
+uint16_t mapValue(int32_t value, int32_t valueMinimum, int32_t valueMaximum)
+{
+  int32_t realMinimum = min(valueMinimum, valueMaximum);
+  int32_t realMaximum = max(valueMinimum, valueMaximum);
+  if (value < realMinimum) value = realMinimum;
+  if (value > realMaximum) value = realMaximum;
+  if (valueMinimum > valueMaximum) value = realMaximum - value + realMinimum;
+  return map(value, realMinimum, realMaximum, 0, 65535);
+}
+
+uint16_t timeMap()
+{
+  uint8_t sreg = SREG;
+  cli();
+  TCNT1 = 0;
+  for (int i = 0; i < BENCH_VALUES; i++)
+  {
+    int32_t minimum = scales[i].inverted ? scales[i].high : scales[i].low;
+    int32_t maximum = scales[i].inverted ? scales[i].low : scales[i].high;
+    sink = mapValue(values[i], minimum, maximum);
+  }
+  uint16_t t = TCNT1;
+  SREG = sreg;
+  return t;
+}
+
+uint16_t timeScale()
+{
+  uint8_t sreg = SREG;
+  cli();
+  TCNT1 = 0;
+  for (int i = 0; i < BENCH_VALUES; i++)
+  {
+    sink = scales[i].scale(values[i]);
+  }
+  uint16_t t = TCNT1;
+  SREG = sreg;
+  return t;
+}
+
+// The old sendState(): buttons, hat switches, then every value through
+// mapValue() into the report, compared with the last report sent
+void legacySendState()
+{
+  uint8_t data[LEGACY_REPORT_SIZE];
+  int index = 0;
+  for (; index < LEGACY_BUTTON_BYTES; index++)
+  {
+    data[index] = legacyButtons[index];
+  }
+  uint8_t convertedHatSwitch[2];
+  for (int hat = 0; hat < 2; hat++)
+  {
+    convertedHatSwitch[hat] = legacyHatSwitch[hat] < 0 ? 8 : (legacyHatSwitch[hat] % 360) / 45;
+  }
+  data[index++] = (convertedHatSwitch[1] << 4) | (B00001111 & convertedHatSwitch[0]);
+  for (int i = 0; i < BENCH_VALUES; i++)
+  {
+    uint16_t converted = mapValue(legacyValues[i], JOYSTICK_DEFAULT_AXIS_MINIMUM, JOYSTICK_DEFAULT_AXIS_MAXIMUM);
+    data[index++] = (uint8_t)(converted & 0x00FF);
+    data[index++] = (uint8_t)(converted >> 8);
+  }
+  if (legacyReportValid && memcmp(data, legacyReport, LEGACY_REPORT_SIZE) == 0)
+  {
+    return;
+  }
+  memcpy(legacyReport, data, LEGACY_REPORT_SIZE);
+  legacyReportValid = true;
+}
+
+uint16_t timeLegacySendState()
+{
+  uint8_t sreg = SREG;
+  cli();
+  TCNT1 = 0;
+  for (int i = 0; i < BENCH_VALUES; i++)
+  {
+    legacyValues[i] = values[i];
+  }
+  legacySendState();
+  uint16_t t = TCNT1;
+  SREG = sreg;
+  return t;
+}
+
+uint16_t timeSetValues()
+{
+  uint8_t sreg = SREG;
+  cli();
+  TCNT1 = 0;
+  Joystick.setXAxis(values[0]);
+  Joystick.setYAxis(values[1]);
+  Joystick.setZAxis(values[2]);
+  Joystick.setRxAxis(values[3]);
+  Joystick.setRyAxis(values[4]);
+  Joystick.setRzAxis(values[5]);
+  Joystick.setRudder(values[6]);
+  Joystick.setThrottle(values[7]);
+  Joystick.setAccelerator(values[8]);
+  Joystick.setBrake(values[9]);
+  Joystick.setSteering(values[10]);
+  uint16_t t = TCNT1;
+  SREG = sreg;
+  return t;
+}
+
+uint16_t timeSendState()
+{
+  uint8_t sreg = SREG;
+  cli();
+  TCNT1 = 0;
+  Joystick.sendState();
+  uint16_t t = TCNT1;
+  SREG = sreg;
+  return t;
+}
+
+void setup()
+{
+  Serial.begin(115200);
+  while (!Serial)
+  {
+  }
+  Joystick.begin(false);
+  TCCR1A = 0;
+  TCCR1B = _BV(CS10);
+
+  uint32_t totalMap = 0;
+  uint32_t totalScale = 0;
+  uint32_t totalSetValues = 0;
+  uint32_t totalSendState = 0;
+  uint32_t totalLegacySendState = 0;
+  for (int run = 0; run < BENCH_RUNS; run++)
+  {
+    for (int i = 0; i < BENCH_VALUES; i++)
+    {
+      values[i] = random(-600, 2048);
+    }
+    totalMap += timeMap();
+    totalScale += timeScale();
+
+    totalLegacySendState += timeLegacySendState();
+
+    totalSetValues += timeSetValues();
+    Joystick.sendState();
+    totalSendState += timeSendState();
+  }
+  cyclesMap = totalMap / BENCH_RUNS;
+  cyclesScale = totalScale / BENCH_RUNS;
+  cyclesSetValues = totalSetValues / BENCH_RUNS;
+  cyclesSendState = totalSendState / BENCH_RUNS;
+  cyclesLegacySendState = totalLegacySendState / BENCH_RUNS;
+}
+
+void loop()
+{
+  Serial.print("11 values, map(): ");
+  Serial.print(cyclesMap);
+  Serial.print(" cycles, precomputed scale: ");
+  Serial.print(cyclesScale);
+  Serial.println(" cycles");
+  Serial.print("set 11 values + sendState(): ");
+  Serial.print(cyclesSetValues + cyclesSendState);
+  Serial.print(" cycles (");
+  Serial.print(cyclesSetValues);
+  Serial.print(" + ");
+  Serial.print(cyclesSendState);
+  Serial.print("), old map() sendState(): ");
+  Serial.print(cyclesLegacySendState);
+  Serial.println(" cycles, transfers excluded");
+  delay(1000);
+}
@@ -26,6 +26,7 @@
 #ifdef _VARIANT_ARDUINO_DUE_X_
 #define USB_SendControl USBD_SendControl
 #define USB_Send USBD_Send
+#define USB_SendSpace USBD_SendSpace
 #endif
 
 DynamicHID_& DynamicHID()
@@ -96,10 +97,24 @@ void DynamicHID_::AppendDescriptor(DynamicHIDSubDescriptor *node)
 
 int DynamicHID_::SendReport(uint8_t id, const void* data, int len)
 {
-	uint8_t p[len + 1];
-	p[0] = id;
-	memcpy(&p[1], data, len);
-	return USB_Send(pluggedEndpoint | TRANSFER_RELEASE, p, len + 1);
+	// The ID and the data go into the same bank, which is only released
+	// after the data, so there is no need to join them in a stack copy
+	int ret = USB_Send(pluggedEndpoint, &id, 1);
+	if (ret < 0) return ret;
+	int ret2 = USB_Send(pluggedEndpoint | TRANSFER_RELEASE, data, len);
+	if (ret2 < 0) return ret2;
+	return ret + ret2;
+}
+
+int DynamicHID_::SendRawReport(const void* report, int len)
+{
+	return USB_Send(pluggedEndpoint | TRANSFER_RELEASE, report, len);
+}
+
+bool DynamicHID_::SendReady(int len)
+{
+	// No room while the host has not read the previous report yet, e.g. when suspended
+	return USB_SendSpace(pluggedEndpoint) >= len;
 }
 
 bool DynamicHID_::setup(USBSetup& setup)
@@ -135,7 +150,8 @@ bool DynamicHID_::setup(USBSetup& setup)
 			return true;
 		}
 		if (request == DYNAMIC_HID_SET_IDLE) {
-			idle = setup.wValueL;
+			// Duration is the high byte, the low byte is the report ID it applies to
+			idle = setup.wValueH;
 			return true;
 		}
 		if (request == DYNAMIC_HID_SET_REPORT)
@@ -155,7 +171,7 @@ bool DynamicHID_::setup(USBSetup& setup)
 
 DynamicHID_::DynamicHID_(void) : PluggableUSBModule(1, 1, epType),
                    rootNode(NULL), descriptorSize(0),
-                   protocol(DYNAMIC_HID_REPORT_PROTOCOL), idle(1)
+                   protocol(DYNAMIC_HID_REPORT_PROTOCOL), idle(0)
 {
 	epType[0] = EP_TYPE_INTERRUPT_IN;
 	PluggableUSB().plug(this);
@@ -109,7 +109,13 @@ public:
   DynamicHID_(void);
   int begin(void);
   int SendReport(uint8_t id, const void* data, int len);
+  // Sends a report whose first byte is already the report ID, straight from the caller's buffer
+  int SendRawReport(const void* report, int len);
+  // Whether len bytes fit into the IN endpoint now, so that sending them does not wait for the host
+  bool SendReady(int len);
   void AppendDescriptor(DynamicHIDSubDescriptor* node);
+  // Idle rate from the host's last SET_IDLE, in 4 ms units; 0 = only report on change
+  uint8_t getIdle(void) { return idle; }
 
 protected:
   // Implementation of the PluggableUSBModule
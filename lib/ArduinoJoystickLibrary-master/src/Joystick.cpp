@@ -28,18 +28,38 @@
 #define JOYSTICK_SIMULATOR_MINIMUM 0
 #define JOYSTICK_SIMULATOR_MAXIMUM 65535
 
-#define JOYSTICK_INCLUDE_X_AXIS  B00000001
-#define JOYSTICK_INCLUDE_Y_AXIS  B00000010
-#define JOYSTICK_INCLUDE_Z_AXIS  B00000100
-#define JOYSTICK_INCLUDE_RX_AXIS B00001000
-#define JOYSTICK_INCLUDE_RY_AXIS B00010000
-#define JOYSTICK_INCLUDE_RZ_AXIS B00100000
-
-#define JOYSTICK_INCLUDE_RUDDER      B00000001
-#define JOYSTICK_INCLUDE_THROTTLE    B00000010
-#define JOYSTICK_INCLUDE_ACCELERATOR B00000100
-#define JOYSTICK_INCLUDE_BRAKE       B00001000
-#define JOYSTICK_INCLUDE_STEERING    B00010000
+#if JOYSTICK_AXIS_MINIMUM != 0 || JOYSTICK_AXIS_MAXIMUM != 65535 \
+    || JOYSTICK_SIMULATOR_MINIMUM != 0 || JOYSTICK_SIMULATOR_MAXIMUM != 65535
+#error JoystickAxisScale only produces the full 0..65535 report range
+#endif
+
+void JoystickAxisScale::setRange(int32_t minimum, int32_t maximum)
+{
+	// Values go from a larger number to a smaller number (e.g. 1024 to 0)
+	inverted = minimum > maximum;
+	low = inverted ? maximum : minimum;
+	high = inverted ? minimum : maximum;
+
+	uint32_t span = (uint32_t)high - (uint32_t)low;
+	shift = 0;
+	if (span == 0) {
+		// Every value reports as the minimum
+		factor = 0;
+		return;
+	}
+	while (span > 0xFFFF) {
+		span >>= 1;
+		shift--;
+	}
+	while (span < 0x8000) {
+		span <<= 1;
+		shift++;
+	}
+
+	// 65535 / span rounded up, as 1 + factor / 65536, so the top of the
+	// range lands on exactly 65535 and nothing overshoots it
+	factor = (uint16_t)((0xFFFF0000UL + span - 1) / span - 0x10000UL);
+}
 
 Joystick_::Joystick_(
 	uint8_t hidReportId,
@@ -57,10 +77,8 @@ Joystick_::Joystick_(
 	bool includeAccelerator,
 	bool includeBrake,
 	bool includeSteering)
+	: JoystickReporter_(hidReportId)
 {
-    // Set the USB HID Report ID
-    _hidReportId = hidReportId;
-
     // Save Joystick Settings
     _buttonCount = buttonCount;
 	_hatSwitchCount = hatSwitchCount;
@@ -454,6 +472,7 @@ Joystick_::Joystick_(
 	_hidReportSize += (_hatSwitchCount > 0);
 	_hidReportSize += (axisCount * 2);
 	_hidReportSize += (simulationCount * 2);
+	setReportBuffer(new uint8_t[1 + _hidReportSize]);
 	
 	// Initialize Joystick State
 	_xAxis = 0;
@@ -487,6 +506,24 @@ void Joystick_::end()
 {
 }
 
+void Joystick_::beginTransaction()
+{
+	if (_inTransaction) return;
+
+	_transactionAutoSendState = _autoSendState;
+	_autoSendState = false;
+	_inTransaction = true;
+}
+
+void Joystick_::commitTransaction()
+{
+	if (!_inTransaction) return;
+
+	_autoSendState = _transactionAutoSendState;
+	_inTransaction = false;
+	sendState();
+}
+
 void Joystick_::setButton(uint8_t button, uint8_t value)
 {
 	if (value == 0)
@@ -585,58 +622,26 @@ void Joystick_::setHatSwitch(int8_t hatSwitchIndex, int16_t value)
 	if (_autoSendState) sendState();
 }
 
-int Joystick_::buildAndSet16BitValue(bool includeValue, int32_t value, int32_t valueMinimum, int32_t valueMaximum, int32_t actualMinimum, int32_t actualMaximum, uint8_t dataLocation[]) 
+int Joystick_::buildAndSet16BitValue(bool includeValue, int32_t value, const JoystickAxisScale &scale, uint8_t index) 
 {
-	int32_t convertedValue;
-	uint8_t highByte;
-	uint8_t lowByte;
-	int32_t realMinimum = min(valueMinimum, valueMaximum);
-	int32_t realMaximum = max(valueMinimum, valueMaximum);
-
 	if (includeValue == false) return 0;
 
-	if (value < realMinimum) {
-		value = realMinimum;
-	}
-	if (value > realMaximum) {
-		value = realMaximum;
-	}
-
-	if (valueMinimum > valueMaximum) {
-		// Values go from a larger number to a smaller number (e.g. 1024 to 0)
-		value = realMaximum - value + realMinimum;
-	}
+	uint16_t convertedValue = scale.scale(value);
 
-	convertedValue = map(value, realMinimum, realMaximum, actualMinimum, actualMaximum);
-
-	highByte = (uint8_t)(convertedValue >> 8);
-	lowByte = (uint8_t)(convertedValue & 0x00FF);
-	
-	dataLocation[0] = lowByte;
-	dataLocation[1] = highByte;
+	writeReport(index, (uint8_t)(convertedValue & 0x00FF));
+	writeReport(index + 1, (uint8_t)(convertedValue >> 8));
 	
 	return 2;
 }
 
-int Joystick_::buildAndSetAxisValue(bool includeAxis, int32_t axisValue, int32_t axisMinimum, int32_t axisMaximum, uint8_t dataLocation[]) 
-{
-	return buildAndSet16BitValue(includeAxis, axisValue, axisMinimum, axisMaximum, JOYSTICK_AXIS_MINIMUM, JOYSTICK_AXIS_MAXIMUM, dataLocation);
-}
-
-int Joystick_::buildAndSetSimulationValue(bool includeValue, int32_t value, int32_t valueMinimum, int32_t valueMaximum, uint8_t dataLocation[]) 
-{
-	return buildAndSet16BitValue(includeValue, value, valueMinimum, valueMaximum, JOYSTICK_SIMULATOR_MINIMUM, JOYSTICK_SIMULATOR_MAXIMUM, dataLocation);
-}
-
 void Joystick_::sendState()
 {
-	uint8_t data[_hidReportSize];
-	int index = 0;
+	uint8_t index = 0;
 	
 	// Load Button State
 	for (; index < _buttonValuesArraySize; index++)
 	{
-		data[index] = _buttonValues[index];		
+		writeReport(index, _buttonValues[index]);
 	}
 
 	// Set Hat Switch Values
@@ -657,26 +662,86 @@ void Joystick_::sendState()
 		}
 
 		// Pack hat-switch states into a single byte
-		data[index++] = (convertedHatSwitch[1] << 4) | (B00001111 & convertedHatSwitch[0]);
+		writeReport(index++, (convertedHatSwitch[1] << 4) | (B00001111 & convertedHatSwitch[0]));
 	
 	} // Hat Switches
 
 	// Set Axis Values
-	index += buildAndSetAxisValue(_includeAxisFlags & JOYSTICK_INCLUDE_X_AXIS, _xAxis, _xAxisMinimum, _xAxisMaximum, &(data[index]));
-	index += buildAndSetAxisValue(_includeAxisFlags & JOYSTICK_INCLUDE_Y_AXIS, _yAxis, _yAxisMinimum, _yAxisMaximum, &(data[index]));
-	index += buildAndSetAxisValue(_includeAxisFlags & JOYSTICK_INCLUDE_Z_AXIS, _zAxis, _zAxisMinimum, _zAxisMaximum, &(data[index]));
-	index += buildAndSetAxisValue(_includeAxisFlags & JOYSTICK_INCLUDE_RX_AXIS, _xAxisRotation, _rxAxisMinimum, _rxAxisMaximum, &(data[index]));
-	index += buildAndSetAxisValue(_includeAxisFlags & JOYSTICK_INCLUDE_RY_AXIS, _yAxisRotation, _ryAxisMinimum, _ryAxisMaximum, &(data[index]));
-	index += buildAndSetAxisValue(_includeAxisFlags & JOYSTICK_INCLUDE_RZ_AXIS, _zAxisRotation, _rzAxisMinimum, _rzAxisMaximum, &(data[index]));
+	index += buildAndSet16BitValue(_includeAxisFlags & JOYSTICK_INCLUDE_X_AXIS, _xAxis, _xAxisScale, index);
+	index += buildAndSet16BitValue(_includeAxisFlags & JOYSTICK_INCLUDE_Y_AXIS, _yAxis, _yAxisScale, index);
+	index += buildAndSet16BitValue(_includeAxisFlags & JOYSTICK_INCLUDE_Z_AXIS, _zAxis, _zAxisScale, index);
+	index += buildAndSet16BitValue(_includeAxisFlags & JOYSTICK_INCLUDE_RX_AXIS, _xAxisRotation, _rxAxisScale, index);
+	index += buildAndSet16BitValue(_includeAxisFlags & JOYSTICK_INCLUDE_RY_AXIS, _yAxisRotation, _ryAxisScale, index);
+	index += buildAndSet16BitValue(_includeAxisFlags & JOYSTICK_INCLUDE_RZ_AXIS, _zAxisRotation, _rzAxisScale, index);
 	
 	// Set Simulation Values
-	index += buildAndSetSimulationValue(_includeSimulatorFlags & JOYSTICK_INCLUDE_RUDDER, _rudder, _rudderMinimum, _rudderMaximum, &(data[index]));
-	index += buildAndSetSimulationValue(_includeSimulatorFlags & JOYSTICK_INCLUDE_THROTTLE, _throttle, _throttleMinimum, _throttleMaximum, &(data[index]));
-	index += buildAndSetSimulationValue(_includeSimulatorFlags & JOYSTICK_INCLUDE_ACCELERATOR, _accelerator, _acceleratorMinimum, _acceleratorMaximum, &(data[index]));
-	index += buildAndSetSimulationValue(_includeSimulatorFlags & JOYSTICK_INCLUDE_BRAKE, _brake, _brakeMinimum, _brakeMaximum, &(data[index]));
-	index += buildAndSetSimulationValue(_includeSimulatorFlags & JOYSTICK_INCLUDE_STEERING, _steering, _steeringMinimum, _steeringMaximum, &(data[index]));
+	index += buildAndSet16BitValue(_includeSimulatorFlags & JOYSTICK_INCLUDE_RUDDER, _rudder, _rudderScale, index);
+	index += buildAndSet16BitValue(_includeSimulatorFlags & JOYSTICK_INCLUDE_THROTTLE, _throttle, _throttleScale, index);
+	index += buildAndSet16BitValue(_includeSimulatorFlags & JOYSTICK_INCLUDE_ACCELERATOR, _accelerator, _acceleratorScale, index);
+	index += buildAndSet16BitValue(_includeSimulatorFlags & JOYSTICK_INCLUDE_BRAKE, _brake, _brakeScale, index);
+	index += buildAndSet16BitValue(_includeSimulatorFlags & JOYSTICK_INCLUDE_STEERING, _steering, _steeringScale, index);
+
+	sendIfChanged();
+}
+
+void JoystickReporter_::setReportBuffer(uint8_t *report)
+{
+	_report = report;
+	_report[0] = _hidReportId;
+	memset(&_report[1], 0, _hidReportSize);
+}
+
+void JoystickReporter_::sendIfChanged()
+{
+	if (_reportChanged || (!_reportPending && idleElapsed()))
+	{
+		queueReport();
+	}
+	else
+	{
+		// Nothing changed: only resend as a SET_IDLE keepalive
+		_suppressedReportCount++;
+	}
+	sendPending();
+}
+
+bool JoystickReporter_::idleElapsed()
+{
+	uint8_t idle = DynamicHID().getIdle();
+	return idle != 0 && (millis() - _lastReportMillis) >= idle * 4UL;
+}
+
+// Commit the buffer as the next report to go out
+void JoystickReporter_::queueReport()
+{
+	if (_reportPending) _overwrittenReportCount++;
+	_reportChanged = false;
+	_reportPending = true;
+}
+
+void JoystickReporter_::sendPending()
+{
+	if (!_reportPending) return;
+
+	if (_nonBlockingSend && !DynamicHID().SendReady(1 + _hidReportSize))
+	{
+		_endpointBusyCount++;
+		return;
+	}
+	if (DynamicHID().SendRawReport(_report, 1 + _hidReportSize) < 0) return;
+
+	_reportPending = false;
+	_lastReportMillis = millis();
+	_sentReportCount++;
+}
+
+void JoystickReporter_::poll()
+{
+	// Staged changes would make the buffer a half-built report
+	if (_reportChanged) return;
 
-	DynamicHID().SendReport(_hidReportId, data, _hidReportSize);
+	if (!_reportPending && _sentReportCount > 0 && idleElapsed()) queueReport();
+	sendPending();
 }
 
 #endif
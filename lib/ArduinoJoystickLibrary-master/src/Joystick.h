@@ -55,7 +55,149 @@
 #define JOYSTICK_TYPE_GAMEPAD              0x05
 #define JOYSTICK_TYPE_MULTI_AXIS           0x08
 
-class Joystick_
+#define JOYSTICK_INCLUDE_X_AXIS  B00000001
+#define JOYSTICK_INCLUDE_Y_AXIS  B00000010
+#define JOYSTICK_INCLUDE_Z_AXIS  B00000100
+#define JOYSTICK_INCLUDE_RX_AXIS B00001000
+#define JOYSTICK_INCLUDE_RY_AXIS B00010000
+#define JOYSTICK_INCLUDE_RZ_AXIS B00100000
+#define JOYSTICK_INCLUDE_ALL_AXES B00111111
+
+#define JOYSTICK_INCLUDE_RUDDER      B00000001
+#define JOYSTICK_INCLUDE_THROTTLE    B00000010
+#define JOYSTICK_INCLUDE_ACCELERATOR B00000100
+#define JOYSTICK_INCLUDE_BRAKE       B00001000
+#define JOYSTICK_INCLUDE_STEERING    B00010000
+#define JOYSTICK_INCLUDE_ALL_SIMULATOR B00011111
+
+// Maps an axis or simulator value from its user range onto the 0..65535 of
+// the report. The division is done once in setRange(): the span is normalized
+// by a shift into 32768..65535, so a report only costs a clamp, a shift and a
+// 16x16 multiply-high. Results are within one count of map() and both range
+// ends are exact; spans wider than 16 bits drop their low bits.
+struct JoystickAxisScale
+{
+    int32_t   low;
+    int32_t   high;
+    uint16_t  factor;   // Q16 fraction of the normalized value added on top
+    int8_t    shift;    // left (> 0) or right (< 0) shift normalizing the span
+    bool      inverted; // minimum > maximum, high maps to 0
+
+    JoystickAxisScale(int32_t minimum = JOYSTICK_DEFAULT_AXIS_MINIMUM, int32_t maximum = JOYSTICK_DEFAULT_AXIS_MAXIMUM)
+    {
+        setRange(minimum, maximum);
+    }
+
+    void setRange(int32_t minimum, int32_t maximum);
+
+    inline uint16_t scale(int32_t value) const
+    {
+        if (value < low) value = low;
+        if (value > high) value = high;
+        uint32_t offset = inverted ? (uint32_t)high - (uint32_t)value : (uint32_t)value - (uint32_t)low;
+        uint16_t normalized = shift >= 0 ? (uint16_t)(offset << shift) : (uint16_t)(offset >> -shift);
+        return normalized + (uint16_t)(((uint32_t)normalized * factor) >> 16);
+    }
+};
+
+// Report sending shared by Joystick_ and Joystick<Config>. The derived class
+// owns one persistent report buffer, report ID first, and writes the report
+// into it through writeReport(), which notes whether anything changed. The
+// buffer goes to the endpoint as is: no copy, no stack buffer. A report is
+// only sent when it changed, or again when the host's SET_IDLE period ends.
+//
+// In non-blocking mode the buffer doubles as a one-slot mailbox: a report
+// that finds the IN endpoint busy stays pending and is sent by a later
+// sendState() or poll(), and a newer report replaces it (latest value wins).
+class JoystickReporter_
+{
+private:
+    uint8_t  *_report = NULL;
+    bool      _reportChanged = true; // written since the last sendState()
+    bool      _reportPending = false; // waiting for the endpoint
+    bool      _nonBlockingSend = false;
+    uint32_t  _lastReportMillis = 0;
+
+    // Statistics
+    uint32_t  _sentReportCount = 0;
+    uint32_t  _suppressedReportCount = 0;
+    uint32_t  _overwrittenReportCount = 0;
+    uint32_t  _endpointBusyCount = 0;
+
+    bool idleElapsed();
+    void queueReport();
+    void sendPending();
+
+protected:
+    uint8_t   _hidReportId;
+    uint8_t   _hidReportSize;
+
+    JoystickReporter_(uint8_t hidReportId, uint8_t hidReportSize = 0)
+        : _hidReportId(hidReportId), _hidReportSize(hidReportSize)
+    {
+    }
+
+    // report must hold the ID byte plus _hidReportSize bytes; it is cleared
+    void setReportBuffer(uint8_t *report);
+
+    inline uint8_t readReport(uint8_t index) const
+    {
+        return _report[1 + index];
+    }
+
+    // Set byte index of the report data (after the ID)
+    inline void writeReport(uint8_t index, uint8_t value)
+    {
+        if (_report[1 + index] != value) {
+            _report[1 + index] = value;
+            _reportChanged = true;
+        }
+    }
+
+    // Send the report unless nothing changed since the last one
+    void sendIfChanged();
+
+public:
+    // Never wait for the host: a report that finds the IN endpoint busy is
+    // kept and sent by a later sendState() or poll(). Off by default, where
+    // sending waits for the endpoint as USB_Send does.
+    inline void setNonBlockingSend(bool nonBlocking)
+    {
+        _nonBlockingSend = nonBlocking;
+    }
+
+    // Number of HID reports handed to the USB stack since power-up
+    inline uint32_t getSentReportCount() const
+    {
+        return _sentReportCount;
+    }
+
+    // Number of reports not sent because they matched the last one
+    inline uint32_t getSuppressedReportCount() const
+    {
+        return _suppressedReportCount;
+    }
+
+    // Number of reports replaced by a newer one while waiting for the endpoint
+    inline uint32_t getOverwrittenReportCount() const
+    {
+        return _overwrittenReportCount;
+    }
+
+    // Number of send attempts that found the IN endpoint busy (non-blocking mode)
+    inline uint32_t getEndpointBusyCount() const
+    {
+        return _endpointBusyCount;
+    }
+
+    // Send a report left pending by a busy endpoint, or resend the last
+    // report once the host's SET_IDLE period has elapsed. Call from loop();
+    // with nothing pending and the default idle rate of 0 it does nothing.
+    // Nothing is sent while changes are staged but not yet committed.
+    void poll();
+};
+
+class Joystick_ : public JoystickReporter_
 {
 private:
 
@@ -76,41 +218,27 @@ private:
 
     // Joystick Settings
     bool     _autoSendState;
+    bool     _transactionAutoSendState = false;
+    bool     _inTransaction = false;
     uint8_t  _buttonCount;
     uint8_t  _buttonValuesArraySize = 0;
     uint8_t  _hatSwitchCount;
     uint8_t  _includeAxisFlags;
     uint8_t  _includeSimulatorFlags;
-    int32_t  _xAxisMinimum = JOYSTICK_DEFAULT_AXIS_MINIMUM;
-    int32_t  _xAxisMaximum = JOYSTICK_DEFAULT_AXIS_MAXIMUM;
-    int32_t  _yAxisMinimum = JOYSTICK_DEFAULT_AXIS_MINIMUM;
-    int32_t  _yAxisMaximum = JOYSTICK_DEFAULT_AXIS_MAXIMUM;
-    int32_t  _zAxisMinimum = JOYSTICK_DEFAULT_AXIS_MINIMUM;
-    int32_t  _zAxisMaximum = JOYSTICK_DEFAULT_AXIS_MAXIMUM;
-    int32_t  _rxAxisMinimum = JOYSTICK_DEFAULT_AXIS_MINIMUM;
-    int32_t  _rxAxisMaximum = JOYSTICK_DEFAULT_AXIS_MAXIMUM;
-    int32_t  _ryAxisMinimum = JOYSTICK_DEFAULT_AXIS_MINIMUM;
-    int32_t  _ryAxisMaximum = JOYSTICK_DEFAULT_AXIS_MAXIMUM;
-    int32_t  _rzAxisMinimum = JOYSTICK_DEFAULT_AXIS_MINIMUM;
-    int32_t  _rzAxisMaximum = JOYSTICK_DEFAULT_AXIS_MAXIMUM;
-    int32_t  _rudderMinimum = JOYSTICK_DEFAULT_SIMULATOR_MINIMUM;
-    int32_t  _rudderMaximum = JOYSTICK_DEFAULT_SIMULATOR_MAXIMUM;
-    int32_t  _throttleMinimum = JOYSTICK_DEFAULT_SIMULATOR_MINIMUM;
-    int32_t  _throttleMaximum = JOYSTICK_DEFAULT_SIMULATOR_MAXIMUM;
-    int32_t  _acceleratorMinimum = JOYSTICK_DEFAULT_SIMULATOR_MINIMUM;
-    int32_t  _acceleratorMaximum = JOYSTICK_DEFAULT_SIMULATOR_MAXIMUM;
-    int32_t  _brakeMinimum = JOYSTICK_DEFAULT_SIMULATOR_MINIMUM;
-    int32_t  _brakeMaximum = JOYSTICK_DEFAULT_SIMULATOR_MAXIMUM;
-    int32_t  _steeringMinimum = JOYSTICK_DEFAULT_SIMULATOR_MINIMUM;
-    int32_t  _steeringMaximum = JOYSTICK_DEFAULT_SIMULATOR_MAXIMUM;
-
-    uint8_t   _hidReportId;
-    uint8_t   _hidReportSize; 
+    JoystickAxisScale _xAxisScale{JOYSTICK_DEFAULT_AXIS_MINIMUM, JOYSTICK_DEFAULT_AXIS_MAXIMUM};
+    JoystickAxisScale _yAxisScale{JOYSTICK_DEFAULT_AXIS_MINIMUM, JOYSTICK_DEFAULT_AXIS_MAXIMUM};
+    JoystickAxisScale _zAxisScale{JOYSTICK_DEFAULT_AXIS_MINIMUM, JOYSTICK_DEFAULT_AXIS_MAXIMUM};
+    JoystickAxisScale _rxAxisScale{JOYSTICK_DEFAULT_AXIS_MINIMUM, JOYSTICK_DEFAULT_AXIS_MAXIMUM};
+    JoystickAxisScale _ryAxisScale{JOYSTICK_DEFAULT_AXIS_MINIMUM, JOYSTICK_DEFAULT_AXIS_MAXIMUM};
+    JoystickAxisScale _rzAxisScale{JOYSTICK_DEFAULT_AXIS_MINIMUM, JOYSTICK_DEFAULT_AXIS_MAXIMUM};
+    JoystickAxisScale _rudderScale{JOYSTICK_DEFAULT_SIMULATOR_MINIMUM, JOYSTICK_DEFAULT_SIMULATOR_MAXIMUM};
+    JoystickAxisScale _throttleScale{JOYSTICK_DEFAULT_SIMULATOR_MINIMUM, JOYSTICK_DEFAULT_SIMULATOR_MAXIMUM};
+    JoystickAxisScale _acceleratorScale{JOYSTICK_DEFAULT_SIMULATOR_MINIMUM, JOYSTICK_DEFAULT_SIMULATOR_MAXIMUM};
+    JoystickAxisScale _brakeScale{JOYSTICK_DEFAULT_SIMULATOR_MINIMUM, JOYSTICK_DEFAULT_SIMULATOR_MAXIMUM};
+    JoystickAxisScale _steeringScale{JOYSTICK_DEFAULT_SIMULATOR_MINIMUM, JOYSTICK_DEFAULT_SIMULATOR_MAXIMUM};
 
 protected:
-    int buildAndSet16BitValue(bool includeValue, int32_t value, int32_t valueMinimum, int32_t valueMaximum, int32_t actualMinimum, int32_t actualMaximum, uint8_t dataLocation[]);
-    int buildAndSetAxisValue(bool includeAxis, int32_t axisValue, int32_t axisMinimum, int32_t axisMaximum, uint8_t dataLocation[]);
-    int buildAndSetSimulationValue(bool includeValue, int32_t value, int32_t valueMinimum, int32_t valueMaximum, uint8_t dataLocation[]);
+    int buildAndSet16BitValue(bool includeValue, int32_t value, const JoystickAxisScale &scale, uint8_t index);
 
 public:
     Joystick_(
@@ -132,62 +260,61 @@ public:
 
     void begin(bool initAutoSendState = true);
     void end();
-    
+
+    // Transactions: stage any number of axis/button changes between
+    // beginTransaction() and commitTransaction() and send them as a single
+    // HID report, regardless of the auto send state.
+    void beginTransaction();
+    void commitTransaction();
+    inline bool inTransaction() const
+    {
+        return _inTransaction;
+    }
+
     // Set Range Functions
     inline void setXAxisRange(int32_t minimum, int32_t maximum)
     {
-        _xAxisMinimum = minimum;
-        _xAxisMaximum = maximum;
+        _xAxisScale.setRange(minimum, maximum);
     }
     inline void setYAxisRange(int32_t minimum, int32_t maximum)
     {
-        _yAxisMinimum = minimum;
-        _yAxisMaximum = maximum;
+        _yAxisScale.setRange(minimum, maximum);
     }
     inline void setZAxisRange(int32_t minimum, int32_t maximum)
     {
-        _zAxisMinimum = minimum;
-        _zAxisMaximum = maximum;
+        _zAxisScale.setRange(minimum, maximum);
     }
     inline void setRxAxisRange(int32_t minimum, int32_t maximum)
     {
-        _rxAxisMinimum = minimum;
-        _rxAxisMaximum = maximum;
+        _rxAxisScale.setRange(minimum, maximum);
     }
     inline void setRyAxisRange(int32_t minimum, int32_t maximum)
     {
-        _ryAxisMinimum = minimum;
-        _ryAxisMaximum = maximum;
+        _ryAxisScale.setRange(minimum, maximum);
     }
     inline void setRzAxisRange(int32_t minimum, int32_t maximum)
     {
-        _rzAxisMinimum = minimum;
-        _rzAxisMaximum = maximum;
+        _rzAxisScale.setRange(minimum, maximum);
     }
     inline void setRudderRange(int32_t minimum, int32_t maximum)
     {
-        _rudderMinimum = minimum;
-        _rudderMaximum = maximum;
+        _rudderScale.setRange(minimum, maximum);
     }
     inline void setThrottleRange(int32_t minimum, int32_t maximum)
     {
-        _throttleMinimum = minimum;
-        _throttleMaximum = maximum;
+        _throttleScale.setRange(minimum, maximum);
     }
     inline void setAcceleratorRange(int32_t minimum, int32_t maximum)
     {
-        _acceleratorMinimum = minimum;
-        _acceleratorMaximum = maximum;
+        _acceleratorScale.setRange(minimum, maximum);
     }
     inline void setBrakeRange(int32_t minimum, int32_t maximum)
     {
-        _brakeMinimum = minimum;
-        _brakeMaximum = maximum;
+        _brakeScale.setRange(minimum, maximum);
     }
     inline void setSteeringRange(int32_t minimum, int32_t maximum)
     {
-        _steeringMinimum = minimum;
-        _steeringMaximum = maximum;
+        _steeringScale.setRange(minimum, maximum);
     }
 
     // Set Axis Values
@@ -0,0 +1,401 @@
+/*
+  StaticJoystick.h
+
+  Copyright (c) 2015-2017, Matthew Heironimus
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef STATIC_JOYSTICK_h
+#define STATIC_JOYSTICK_h
+
+#include "Joystick.h"
+
+#if defined(_USING_DYNAMIC_HID)
+
+#if __cplusplus < 201402L
+#error StaticJoystick.h builds its HID report descriptor with C++14 constexpr, compile with -std=gnu++14
+#endif
+
+//================================================================================
+//  Joystick<Config>: a joystick whose layout is fixed at compile time
+//
+//  Same HID report descriptor and report format as a Joystick_ built with the
+//  same settings, but the descriptor is generated by the compiler into flash,
+//  report offsets are constants and all state lives in the object: no heap,
+//  no descriptor copy in SRAM. Values are converted and written into the
+//  report buffer when they are set, so set the ranges first. The buffer is
+//  the one handed to the endpoint, with the report ID in front.
+//
+//  The descriptor is declared with JOYSTICK_DESCRIPTOR and passed to the
+//  constructor:
+//
+//    JOYSTICK_DESCRIPTOR(PadConfig, padDescriptor);
+//    Joystick<PadConfig> pad(padDescriptor);
+//
+//  It cannot be a static member of Joystick<Config>: GCC drops the PROGMEM
+//  section attribute on static data members of class templates, and the
+//  descriptor would end up in SRAM while USB reads it from flash.
+
+// Settings of a Joystick<Config>. Any class with these static members works.
+template <
+    uint8_t ReportId = JOYSTICK_DEFAULT_REPORT_ID,
+    uint8_t JoystickType = JOYSTICK_TYPE_JOYSTICK,
+    uint8_t ButtonCount = JOYSTICK_DEFAULT_BUTTON_COUNT,
+    uint8_t HatSwitchCount = JOYSTICK_DEFAULT_HATSWITCH_COUNT,
+    uint8_t AxisFlags = JOYSTICK_INCLUDE_ALL_AXES,
+    uint8_t SimulatorFlags = JOYSTICK_INCLUDE_ALL_SIMULATOR>
+struct JoystickConfig
+{
+    static constexpr uint8_t reportId = ReportId;
+    static constexpr uint8_t joystickType = JoystickType;
+    static constexpr uint8_t buttonCount = ButtonCount;
+    static constexpr uint8_t hatSwitchCount = HatSwitchCount;
+    static constexpr uint8_t axisFlags = AxisFlags;
+    static constexpr uint8_t simulatorFlags = SimulatorFlags;
+};
+
+constexpr uint8_t joystickBitCount(uint16_t flags)
+{
+    return flags ? (flags & 1) + joystickBitCount(flags >> 1) : 0;
+}
+
+struct JoystickDescriptorWriter
+{
+    uint8_t  *out;
+    uint8_t   length;
+
+    constexpr void put(uint8_t value)
+    {
+        if (out) out[length] = value;
+        length++;
+    }
+
+    constexpr void item(uint8_t tag, uint8_t value)
+    {
+        put(tag);
+        put(value);
+    }
+};
+
+// Writes the HID report descriptor of a layout to out and returns its length,
+// or only measures it when out is NULL. Byte for byte what the Joystick_
+// constructor builds at run time.
+constexpr uint8_t joystickDescriptor(uint8_t *out, uint8_t reportId, uint8_t joystickType,
+    uint8_t buttonCount, uint8_t hatSwitchCount, uint8_t axisFlags, uint8_t simulatorFlags)
+{
+    const uint8_t simulatorUsages[5] = { 0xBA, 0xBB, 0xC4, 0xC5, 0xC8 };
+    uint8_t axisCount = joystickBitCount(axisFlags);
+    uint8_t simulationCount = joystickBitCount(simulatorFlags);
+    JoystickDescriptorWriter d = { out, 0 };
+
+    d.item(0x05, 0x01);         // USAGE_PAGE (Generic Desktop)
+    d.item(0x09, joystickType); // USAGE (Joystick, Gamepad or Multi-axis Controller)
+    d.item(0xa1, 0x01);         // COLLECTION (Application)
+    d.item(0x85, reportId);     // REPORT_ID
+
+    if (buttonCount > 0) {
+        d.item(0x05, 0x09);        // USAGE_PAGE (Button)
+        d.item(0x19, 0x01);        // USAGE_MINIMUM (Button 1)
+        d.item(0x29, buttonCount); // USAGE_MAXIMUM
+        d.item(0x15, 0x00);        // LOGICAL_MINIMUM (0)
+        d.item(0x25, 0x01);        // LOGICAL_MAXIMUM (1)
+        d.item(0x75, 0x01);        // REPORT_SIZE (1)
+        d.item(0x95, buttonCount); // REPORT_COUNT (# of buttons)
+        d.item(0x55, 0x00);        // UNIT_EXPONENT (0)
+        d.item(0x65, 0x00);        // UNIT (None)
+        d.item(0x81, 0x02);        // INPUT (Data,Var,Abs)
+        if (buttonCount % 8 > 0) {
+            d.item(0x75, 0x01);                  // REPORT_SIZE (1)
+            d.item(0x95, 8 - buttonCount % 8);   // REPORT_COUNT (# of padding bits)
+            d.item(0x81, 0x03);                  // INPUT (Const,Var,Abs)
+        }
+    }
+
+    if (axisCount > 0 || hatSwitchCount > 0) {
+        d.item(0x05, 0x01); // USAGE_PAGE (Generic Desktop)
+    }
+
+    for (uint8_t hatSwitch = 0; hatSwitch < hatSwitchCount; hatSwitch++) {
+        d.item(0x09, 0x39); // USAGE (Hat Switch)
+        d.item(0x15, 0x00); // LOGICAL_MINIMUM (0)
+        d.item(0x25, 0x07); // LOGICAL_MAXIMUM (7)
+        d.item(0x35, 0x00); // PHYSICAL_MINIMUM (0)
+        d.item(0x46, 0x3B); // PHYSICAL_MAXIMUM (315)
+        d.put(0x01);
+        d.item(0x65, 0x14); // UNIT (Eng Rot:Angular Pos)
+        d.item(0x75, 0x04); // REPORT_SIZE (4)
+        d.item(0x95, 0x01); // REPORT_COUNT (1)
+        d.item(0x81, 0x02); // INPUT (Data,Var,Abs)
+    }
+    if (hatSwitchCount == 1) {
+        d.item(0x75, 0x01); // REPORT_SIZE (1)
+        d.item(0x95, 0x04); // REPORT_COUNT (4 padding bits)
+        d.item(0x81, 0x03); // INPUT (Const,Var,Abs)
+    }
+
+    if (axisCount > 0) {
+        d.item(0x09, 0x01);      // USAGE (Pointer)
+        d.item(0x15, 0x00);      // LOGICAL_MINIMUM (0)
+        d.item(0x27, 0xFF);      // LOGICAL_MAXIMUM (65535)
+        d.put(0xFF);
+        d.put(0x00);
+        d.put(0x00);
+        d.item(0x75, 0x10);      // REPORT_SIZE (16)
+        d.item(0x95, axisCount); // REPORT_COUNT (axisCount)
+        d.item(0xA1, 0x00);      // COLLECTION (Physical)
+        for (uint8_t axis = 0; axis < 6; axis++) {
+            if (axisFlags & (1 << axis)) {
+                d.item(0x09, 0x30 + axis); // USAGE (X, Y, Z, Rx, Ry or Rz)
+            }
+        }
+        d.item(0x81, 0x02);      // INPUT (Data,Var,Abs)
+        d.put(0xc0);             // END_COLLECTION (Physical)
+    }
+
+    if (simulationCount > 0) {
+        d.item(0x05, 0x02);            // USAGE_PAGE (Simulation Controls)
+        d.item(0x15, 0x00);            // LOGICAL_MINIMUM (0)
+        d.item(0x27, 0xFF);            // LOGICAL_MAXIMUM (65535)
+        d.put(0xFF);
+        d.put(0x00);
+        d.put(0x00);
+        d.item(0x75, 0x10);            // REPORT_SIZE (16)
+        d.item(0x95, simulationCount); // REPORT_COUNT (simulationCount)
+        d.item(0xA1, 0x00);            // COLLECTION (Physical)
+        for (uint8_t control = 0; control < 5; control++) {
+            if (simulatorFlags & (1 << control)) {
+                d.item(0x09, simulatorUsages[control]); // USAGE (Rudder, Throttle, Accelerator, Brake or Steering)
+            }
+        }
+        d.item(0x81, 0x02);            // INPUT (Data,Var,Abs)
+        d.put(0xc0);                   // END_COLLECTION (Physical)
+    }
+
+    d.put(0xc0); // END_COLLECTION
+    return d.length;
+}
+
+template <class Config>
+constexpr uint8_t joystickDescriptorLength()
+{
+    return joystickDescriptor(NULL, Config::reportId, Config::joystickType, Config::buttonCount,
+        Config::hatSwitchCount, Config::axisFlags, Config::simulatorFlags);
+}
+
+template <uint8_t Length>
+struct JoystickDescriptor
+{
+    uint8_t bytes[Length];
+};
+
+template <class Config>
+constexpr JoystickDescriptor<joystickDescriptorLength<Config>()> makeJoystickDescriptor()
+{
+    JoystickDescriptor<joystickDescriptorLength<Config>()> descriptor = {};
+    joystickDescriptor(descriptor.bytes, Config::reportId, Config::joystickType, Config::buttonCount,
+        Config::hatSwitchCount, Config::axisFlags, Config::simulatorFlags);
+    return descriptor;
+}
+
+// Defines `name`, the flash-resident descriptor for Config, at namespace scope
+#define JOYSTICK_DESCRIPTOR(Config, name) \
+    constexpr JoystickDescriptor<joystickDescriptorLength<Config>()> name PROGMEM = makeJoystickDescriptor<Config>()
+
+template <class Config = JoystickConfig<> >
+class Joystick : public JoystickReporter_
+{
+private:
+    static_assert(Config::hatSwitchCount <= JOYSTICK_HATSWITCH_COUNT_MAXIMUM, "Joystick supports up to 2 hat switches");
+    static_assert((Config::axisFlags & ~JOYSTICK_INCLUDE_ALL_AXES) == 0, "Unknown axis flags");
+    static_assert((Config::simulatorFlags & ~JOYSTICK_INCLUDE_ALL_SIMULATOR) == 0, "Unknown simulator flags");
+
+    // Axes and simulator controls share one 16-bit value area in the report,
+    // axes in the low six bits of these flags, simulator controls above
+    static constexpr uint16_t valueFlags = Config::axisFlags | (Config::simulatorFlags << 6);
+    static constexpr uint8_t valueCount = joystickBitCount(valueFlags);
+
+    // Report layout: button bits, the hat switch byte, then the values
+    static constexpr uint8_t buttonBytes = (Config::buttonCount + 7) / 8;
+    static constexpr uint8_t hatSwitchOffset = buttonBytes;
+    static constexpr uint8_t valueOffset = buttonBytes + (Config::hatSwitchCount > 0);
+
+    uint8_t   _report[1 + valueOffset + 2 * valueCount]; // report ID first
+    JoystickAxisScale _scales[valueCount > 0 ? valueCount : 1];
+    DynamicHIDSubDescriptor _descriptorNode;
+
+    bool      _autoSendState = true;
+    bool      _transactionAutoSendState = false;
+    bool      _inTransaction = false;
+
+    // Position of a value among the included ones
+    template <uint16_t Flag>
+    static constexpr uint8_t valueIndex()
+    {
+        return joystickBitCount(valueFlags & (Flag - 1));
+    }
+
+    template <uint16_t Flag>
+    inline void setRange(int32_t minimum, int32_t maximum)
+    {
+        if (valueFlags & Flag) _scales[valueIndex<Flag>()].setRange(minimum, maximum);
+    }
+
+    template <uint16_t Flag>
+    inline void setValue(int32_t value)
+    {
+        if (!(valueFlags & Flag)) return;
+
+        uint16_t convertedValue = _scales[valueIndex<Flag>()].scale(value);
+        writeReport(valueOffset + 2 * valueIndex<Flag>(), (uint8_t)(convertedValue & 0x00FF));
+        writeReport(valueOffset + 2 * valueIndex<Flag>() + 1, (uint8_t)(convertedValue >> 8));
+        if (_autoSendState) sendState();
+    }
+
+public:
+    typedef JoystickDescriptor<joystickDescriptorLength<Config>()> Descriptor;
+
+    static constexpr uint8_t reportSize = valueOffset + 2 * valueCount;
+    static constexpr uint8_t descriptorLength = sizeof(Descriptor);
+
+    // descriptor: the JOYSTICK_DESCRIPTOR for the same Config, in flash
+    explicit Joystick(const Descriptor &descriptor)
+        : JoystickReporter_(Config::reportId, reportSize),
+          _descriptorNode(descriptor.bytes, descriptorLength)
+    {
+        DynamicHID().AppendDescriptor(&_descriptorNode);
+
+        setReportBuffer(_report);
+        if (Config::hatSwitchCount > 0) {
+            writeReport(hatSwitchOffset, (8 << 4) | 8);
+        }
+        for (uint8_t control = 0; control < 5; control++) {
+            uint16_t flag = 1 << (6 + control);
+            if (valueFlags & flag) {
+                _scales[joystickBitCount(valueFlags & (flag - 1))].setRange(JOYSTICK_DEFAULT_SIMULATOR_MINIMUM, JOYSTICK_DEFAULT_SIMULATOR_MAXIMUM);
+            }
+        }
+    }
+
+    void begin(bool initAutoSendState = true)
+    {
+        _autoSendState = initAutoSendState;
+        sendState();
+    }
+
+    void end()
+    {
+    }
+
+    // Transactions: stage any number of axis/button changes between
+    // beginTransaction() and commitTransaction() and send them as a single
+    // HID report, regardless of the auto send state.
+    void beginTransaction()
+    {
+        if (_inTransaction) return;
+
+        _transactionAutoSendState = _autoSendState;
+        _autoSendState = false;
+        _inTransaction = true;
+    }
+
+    void commitTransaction()
+    {
+        if (!_inTransaction) return;
+
+        _autoSendState = _transactionAutoSendState;
+        _inTransaction = false;
+        sendState();
+    }
+
+    inline bool inTransaction() const
+    {
+        return _inTransaction;
+    }
+
+    // Set Range Functions
+    inline void setXAxisRange(int32_t minimum, int32_t maximum) { setRange<JOYSTICK_INCLUDE_X_AXIS>(minimum, maximum); }
+    inline void setYAxisRange(int32_t minimum, int32_t maximum) { setRange<JOYSTICK_INCLUDE_Y_AXIS>(minimum, maximum); }
+    inline void setZAxisRange(int32_t minimum, int32_t maximum) { setRange<JOYSTICK_INCLUDE_Z_AXIS>(minimum, maximum); }
+    inline void setRxAxisRange(int32_t minimum, int32_t maximum) { setRange<JOYSTICK_INCLUDE_RX_AXIS>(minimum, maximum); }
+    inline void setRyAxisRange(int32_t minimum, int32_t maximum) { setRange<JOYSTICK_INCLUDE_RY_AXIS>(minimum, maximum); }
+    inline void setRzAxisRange(int32_t minimum, int32_t maximum) { setRange<JOYSTICK_INCLUDE_RZ_AXIS>(minimum, maximum); }
+    inline void setRudderRange(int32_t minimum, int32_t maximum) { setRange<(JOYSTICK_INCLUDE_RUDDER << 6)>(minimum, maximum); }
+    inline void setThrottleRange(int32_t minimum, int32_t maximum) { setRange<(JOYSTICK_INCLUDE_THROTTLE << 6)>(minimum, maximum); }
+    inline void setAcceleratorRange(int32_t minimum, int32_t maximum) { setRange<(JOYSTICK_INCLUDE_ACCELERATOR << 6)>(minimum, maximum); }
+    inline void setBrakeRange(int32_t minimum, int32_t maximum) { setRange<(JOYSTICK_INCLUDE_BRAKE << 6)>(minimum, maximum); }
+    inline void setSteeringRange(int32_t minimum, int32_t maximum) { setRange<(JOYSTICK_INCLUDE_STEERING << 6)>(minimum, maximum); }
+
+    // Set Axis Values
+    inline void setXAxis(int32_t value) { setValue<JOYSTICK_INCLUDE_X_AXIS>(value); }
+    inline void setYAxis(int32_t value) { setValue<JOYSTICK_INCLUDE_Y_AXIS>(value); }
+    inline void setZAxis(int32_t value) { setValue<JOYSTICK_INCLUDE_Z_AXIS>(value); }
+    inline void setRxAxis(int32_t value) { setValue<JOYSTICK_INCLUDE_RX_AXIS>(value); }
+    inline void setRyAxis(int32_t value) { setValue<JOYSTICK_INCLUDE_RY_AXIS>(value); }
+    inline void setRzAxis(int32_t value) { setValue<JOYSTICK_INCLUDE_RZ_AXIS>(value); }
+
+    // Set Simulation Values
+    inline void setRudder(int32_t value) { setValue<(JOYSTICK_INCLUDE_RUDDER << 6)>(value); }
+    inline void setThrottle(int32_t value) { setValue<(JOYSTICK_INCLUDE_THROTTLE << 6)>(value); }
+    inline void setAccelerator(int32_t value) { setValue<(JOYSTICK_INCLUDE_ACCELERATOR << 6)>(value); }
+    inline void setBrake(int32_t value) { setValue<(JOYSTICK_INCLUDE_BRAKE << 6)>(value); }
+    inline void setSteering(int32_t value) { setValue<(JOYSTICK_INCLUDE_STEERING << 6)>(value); }
+
+    void setButton(uint8_t button, uint8_t value)
+    {
+        if (value == 0)
+        {
+            releaseButton(button);
+        }
+        else
+        {
+            pressButton(button);
+        }
+    }
+
+    void pressButton(uint8_t button)
+    {
+        if (button >= Config::buttonCount) return;
+
+        writeReport(button / 8, readReport(button / 8) | (1 << (button % 8)));
+        if (_autoSendState) sendState();
+    }
+
+    void releaseButton(uint8_t button)
+    {
+        if (button >= Config::buttonCount) return;
+
+        writeReport(button / 8, readReport(button / 8) & ~(1 << (button % 8)));
+        if (_autoSendState) sendState();
+    }
+
+    void setHatSwitch(int8_t hatSwitchIndex, int16_t value)
+    {
+        if (hatSwitchIndex < 0 || hatSwitchIndex >= Config::hatSwitchCount) return;
+
+        uint8_t direction = value < 0 ? 8 : (value % 360) / 45;
+        uint8_t shift = hatSwitchIndex * 4;
+        writeReport(hatSwitchOffset, (readReport(hatSwitchOffset) & ~(0x0F << shift)) | (direction << shift));
+        if (_autoSendState) sendState();
+    }
+
+    void sendState()
+    {
+        sendIfChanged();
+    }
+};
+
+#endif // defined(_USING_DYNAMIC_HID)
+#endif // STATIC_JOYSTICK_h
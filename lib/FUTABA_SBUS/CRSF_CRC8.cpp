@@ -0,0 +1,10 @@
+#include "CRSF_CRC8.h"
+
+#define CRSF_CRC8_E(i)    crsf_crc8_entry((i), CRSF_CRC8_POLY)
+#define CRSF_CRC8_R4(i)   CRSF_CRC8_E(i), CRSF_CRC8_E((i) + 1), CRSF_CRC8_E((i) + 2), CRSF_CRC8_E((i) + 3)
+#define CRSF_CRC8_R16(i)  CRSF_CRC8_R4(i), CRSF_CRC8_R4((i) + 4), CRSF_CRC8_R4((i) + 8), CRSF_CRC8_R4((i) + 12)
+#define CRSF_CRC8_R64(i)  CRSF_CRC8_R16(i), CRSF_CRC8_R16((i) + 16), CRSF_CRC8_R16((i) + 32), CRSF_CRC8_R16((i) + 48)
+
+const uint8_t crsf_crc8_table[256] PROGMEM = {
+  CRSF_CRC8_R64(0), CRSF_CRC8_R64(64), CRSF_CRC8_R64(128), CRSF_CRC8_R64(192)
+};
@@ -0,0 +1,37 @@
+#ifndef CRSF_CRC8_h
+#define CRSF_CRC8_h
+
+#include <Arduino.h>
+
+// CRC8 used by CRSF frames: DVB-S2 polynomial 0xD5, init 0, no reflection,
+// computed over type + payload. The 256-entry lookup table is generated by
+// the compiler from the polynomial and lives in flash.
+
+#define CRSF_CRC8_POLY 0xD5
+// Command frames (0x32) carry a second, inner CRC8 with polynomial 0xBA
+#define CRSF_CRC8_COMMAND_POLY 0xBA
+
+constexpr uint8_t crsf_crc8_shift(uint8_t crc, uint8_t poly){
+  return (crc & 0x80) ? (uint8_t)((crc << 1) ^ poly) : (uint8_t)(crc << 1);
+}
+
+// Bitwise CRC of a single byte starting from a zero register (one table entry)
+constexpr uint8_t crsf_crc8_entry(uint8_t crc, uint8_t poly, uint8_t bits = 8){
+  return bits == 0 ? crc : crsf_crc8_entry(crsf_crc8_shift(crc, poly), poly, bits - 1);
+}
+
+static_assert(crsf_crc8_entry(0x01, CRSF_CRC8_POLY) == 0xD5, "CRC8 table generator");
+static_assert(crsf_crc8_entry(0xFF, CRSF_CRC8_POLY) == 0xF9, "CRC8 table generator");
+
+extern const uint8_t crsf_crc8_table[256] PROGMEM;
+
+inline uint8_t crsf_crc8_update(uint8_t crc, uint8_t data){
+  return pgm_read_byte(&crsf_crc8_table[crc ^ data]);
+}
+
+// Command frames are rare, so their inner CRC is computed bitwise
+inline uint8_t crsf_crc8_command_update(uint8_t crc, uint8_t data){
+  return crsf_crc8_entry(crc ^ data, CRSF_CRC8_COMMAND_POLY);
+}
+
+#endif
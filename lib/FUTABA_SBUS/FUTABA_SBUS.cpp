@@ -1,212 +1,350 @@
-#include "FUTABA_SBUS.h"
-#include <Streaming.h>
-void FUTABA_SBUS::begin(){
-	uint8_t loc_sbusData[25] = {
-	  0x0f,0x01,0x04,0x20,0x00,0xff,0x07,0x40,0x00,0x02,0x10,0x80,0x2c,0x64,0x21,0x0b,0x59,0x08,0x40,0x00,0x02,0x10,0x80,0x00,0x00};
-	int16_t loc_channels[18]  = {
-	  		1023,1023,1023,1023,1023,1023,1023,1023,1023,1023,1023,1023,1023,1023,1023,1023,0,0};
-	int16_t loc_servos[18]    = {
-  			1023,1023,1023,1023,1023,1023,1023,1023,1023,1023,1023,1023,1023,1023,1023,1023,0,0};
-  	port.begin(BAUDRATE);
-
-	memcpy(sbusData,loc_sbusData,25);
-	memcpy(channels,loc_channels,18);
-	memcpy(servos,loc_servos,18);
-	failsafe_status = SBUS_SIGNAL_OK;
-	sbus_passthrough = 1;
-	toChannels = 0;
-	bufferIndex=0;
-	feedState = 0;
-}
-
-int16_t FUTABA_SBUS::Channel(uint8_t ch) {
-  // Read channel data
-  if ((ch>0)&&(ch<=16)){
-    return channels[ch-1];
-  }
-  else{
-    return 1023;
-  }
-}
-uint8_t FUTABA_SBUS::DigiChannel(uint8_t ch) {
-  // Read digital channel data
-  if ((ch>0) && (ch<=2)) {
-    return channels[15+ch];
-  }
-  else{
-    return 0;
-  }
-}
-void FUTABA_SBUS::Servo(uint8_t ch, int16_t position) {
-  // Set servo position
-  if ((ch>0)&&(ch<=16)) {
-    if (position>2048) {
-      position=2048;
-    }
-    servos[ch-1] = position;
-  }
-}
-void FUTABA_SBUS::DigiServo(uint8_t ch, uint8_t position) {
-  // Set digital servo position
-  if ((ch>0) && (ch<=2)) {
-    if (position>1) {
-      position=1;
-    }
-    servos[15+ch] = position;
-  }
-}
-uint8_t FUTABA_SBUS::Failsafe(void) {
-  return failsafe_status;
-}
-
-void FUTABA_SBUS::PassthroughSet(int mode) {
-  // Set passtrough mode, if true, received channel data is send to servos
-  sbus_passthrough = mode;
-}
-
-int FUTABA_SBUS::PassthroughRet(void) {
-  // Return current passthrough mode
-  return sbus_passthrough;
-}
-void FUTABA_SBUS::UpdateServos(void) {
-  // Send data to servos
-  // Passtrough mode = false >> send own servo data
-  // Passtrough mode = true >> send received channel data
-  uint8_t i;
-  if (sbus_passthrough==0) {
-    // clear received channel data
-    for (i=1; i<24; i++) {
-      sbusData[i] = 0;
-    }
-
-    // reset counters
-    ch = 0;
-    bit_in_servo = 0;
-    byte_in_sbus = 1;
-    bit_in_sbus = 0;
-
-    // store servo data
-    for (i=0; i<176; i++) {
-      if (servos[ch] & (1<<bit_in_servo)) {
-        sbusData[byte_in_sbus] |= (1<<bit_in_sbus);
-      }
-      bit_in_sbus++;
-      bit_in_servo++;
-
-      if (bit_in_sbus == 8) {
-        bit_in_sbus =0;
-        byte_in_sbus++;
-      }
-      if (bit_in_servo == 11) {
-        bit_in_servo =0;
-        ch++;
-      }
-    }
-
-    // DigiChannel 1
-    if (channels[16] == 1) {
-      sbusData[23] |= (1<<0);
-    }
-    // DigiChannel 2
-    if (channels[17] == 1) {
-      sbusData[23] |= (1<<1);
-    }
-
-    // Failsafe
-    if (failsafe_status == SBUS_SIGNAL_LOST) {
-      sbusData[23] |= (1<<2);
-    }
-
-    if (failsafe_status == SBUS_SIGNAL_FAILSAFE) {
-      sbusData[23] |= (1<<2);
-      sbusData[23] |= (1<<3);
-    }
-  }
-  // send data out
-  //serialPort.write(sbusData,25);
-  for (i=0;i<25;i++) {
-    port.write(sbusData[i]);
-  }
-}
-void FUTABA_SBUS::UpdateChannels(void) {
-  uint8_t i;
-  //uint8_t sbus_pointer = 0;
-  // clear channels[]
-/*
-Serial << "sbusData ";
-
-    for (i=1; i<23; i++) {
-      Serial << sbusData[i] << " ";
-    }
-Serial << "\r\n";*/
-  channels[0]  = ((sbusData[1]|sbusData[2]<< 8) & 0x07FF);
-  channels[1]  = ((sbusData[2]>>3|sbusData[3]<<5) & 0x07FF);
-  channels[2]  = ((sbusData[3]>>6|sbusData[4]<<2|sbusData[5]<<10) & 0x07FF);
-  channels[3]  = ((sbusData[5]>>1|sbusData[6]<<7) & 0x07FF);
-  channels[4]  = ((sbusData[6]>>4|sbusData[7]<<4) & 0x07FF);
-  channels[5]  = ((sbusData[7]>>7|sbusData[8]<<1|sbusData[9]<<9) & 0x07FF);
-  channels[6]  = ((sbusData[9]>>2|sbusData[10]<<6) & 0x07FF);
-  channels[7]  = ((sbusData[10]>>5|sbusData[11]<<3) & 0x07FF); // & the other 8 + 2 channels if you need them
-  #ifdef ALL_CHANNELS
-  channels[8]  = ((sbusData[12]|sbusData[13]<< 8) & 0x07FF);
-  channels[9]  = ((sbusData[13]>>3|sbusData[14]<<5) & 0x07FF);
-  channels[10] = ((sbusData[14]>>6|sbusData[15]<<2|sbusData[16]<<10) & 0x07FF);
-  channels[11] = ((sbusData[16]>>1|sbusData[17]<<7) & 0x07FF);
-  channels[12] = ((sbusData[17]>>4|sbusData[18]<<4) & 0x07FF);
-  channels[13] = ((sbusData[18]>>7|sbusData[19]<<1|sbusData[20]<<9) & 0x07FF);
-  channels[14] = ((sbusData[20]>>2|sbusData[21]<<6) & 0x07FF);
-    channels[15] = ((sbusData[21]>>5|sbusData[22]<<3) & 0x07FF);
-  #endif
-
-  // Failsafe
-  failsafe_status = SBUS_SIGNAL_OK;
-  if (sbusData[23] & (1<<2)) {
-    failsafe_status = SBUS_SIGNAL_LOST;
-  }
-  if (sbusData[23] & (1<<3)) {
-    failsafe_status = SBUS_SIGNAL_FAILSAFE;
-  }
-
-}
-void FUTABA_SBUS::FeedLine(void){
-  //uint16_t other_test; 
-  if (port.available() > 24){
-port.read();
-port.read();
-    while(port.available() > 0){
-      inData = port.read();
-       
-      switch (feedState){
-      case 0:
-        if (inData != 0x16){
-
-          port.flush();
-          return;
-        }
-        else{
-          bufferIndex = 0;
-          inBuffer[bufferIndex] = inData;
-          inBuffer[23] = 0xff;
-          feedState = 1;
-        }
-        break;
-      case 1:
-        bufferIndex ++;
-        inBuffer[bufferIndex] = inData;
-        if (bufferIndex < 23 && port.available() == 0){
-          feedState = 0;
-        }
-        if (bufferIndex == 23){
-          feedState = 0;
-          if (inBuffer[0]==0x16 && inBuffer[23] != 0){
-            memcpy(sbusData,inBuffer,24);
-	          port.flush();
-            toChannels = 1;
-          }
-        }
-        break;
-      }
-    }
-  }
-}
-
+#include "FUTABA_SBUS.h"
+
+void FUTABA_SBUS::begin(){
+	uint8_t loc_sbusData[25] = {
+	  0x0f,0x01,0x04,0x20,0x00,0xff,0x07,0x40,0x00,0x02,0x10,0x80,0x2c,0x64,0x21,0x0b,0x59,0x08,0x40,0x00,0x02,0x10,0x80,0x00,0x00};
+	int16_t loc_channels[18]  = {
+	  		1023,1023,1023,1023,1023,1023,1023,1023,1023,1023,1023,1023,1023,1023,1023,1023,0,0};
+	int16_t loc_servos[18]    = {
+  			1023,1023,1023,1023,1023,1023,1023,1023,1023,1023,1023,1023,1023,1023,1023,1023,0,0};
+  	baudRate = BAUDRATE;
+  	SBUS_UART::begin(baudRate);
+
+	memcpy(sbusData,loc_sbusData,25);
+	memcpy(channels,loc_channels,18);
+	memcpy(servos,loc_servos,18);
+	failsafe_status = SBUS_SIGNAL_OK;
+	sbus_passthrough = 1;
+	toChannels = 0;
+	frameTimestamp = 0;
+	resyncCount = 0;
+	bytesDiscarded = 0;
+	crcErrors = 0;
+	memset(&linkStatistics, 0, sizeof(linkStatistics));
+	linkStatisticsCount = 0;
+	rcPayload = &sbusData[1];
+	frameLength = 0;
+	bufferIndex=0;
+	feedState = FEED_SYNC;
+}
+
+bool FUTABA_SBUS::SetBaudRate(uint32_t baud){
+  if (baud == 0 || SBUS_UART::baudErrorFor(baud) > SBUS_UART_BAUD_ERROR_MAX){
+    return false;
+  }
+  // Let any pending reply finish at the old rate before reprogramming
+  SBUS_UART::flush();
+  SBUS_UART::begin(baud);
+  baudRate = baud;
+  feedState = FEED_SYNC;
+  return true;
+}
+
+uint32_t FUTABA_SBUS::BaudRate(void){
+  return baudRate;
+}
+
+int16_t FUTABA_SBUS::Channel(uint8_t ch) {
+  // Read channel data
+  if ((ch>0)&&(ch<=16)){
+    return channels[ch-1];
+  }
+  else{
+    return 1023;
+  }
+}
+uint8_t FUTABA_SBUS::DigiChannel(uint8_t ch) {
+  // Read digital channel data
+  if ((ch>0) && (ch<=2)) {
+    return channels[15+ch];
+  }
+  else{
+    return 0;
+  }
+}
+void FUTABA_SBUS::Servo(uint8_t ch, int16_t position) {
+  // Set servo position
+  if ((ch>0)&&(ch<=16)) {
+    if (position>2048) {
+      position=2048;
+    }
+    servos[ch-1] = position;
+  }
+}
+void FUTABA_SBUS::DigiServo(uint8_t ch, uint8_t position) {
+  // Set digital servo position
+  if ((ch>0) && (ch<=2)) {
+    if (position>1) {
+      position=1;
+    }
+    servos[15+ch] = position;
+  }
+}
+uint8_t FUTABA_SBUS::Failsafe(void) {
+  return failsafe_status;
+}
+
+void FUTABA_SBUS::PassthroughSet(int mode) {
+  // Set passtrough mode, if true, received channel data is send to servos
+  sbus_passthrough = mode;
+}
+
+int FUTABA_SBUS::PassthroughRet(void) {
+  // Return current passthrough mode
+  return sbus_passthrough;
+}
+void FUTABA_SBUS::UpdateServos(void) {
+  // Send data to servos
+  // Passtrough mode = false >> send own servo data
+  // Passtrough mode = true >> send received channel data
+  uint8_t i;
+  if (sbus_passthrough==0) {
+    // clear received channel data
+    for (i=1; i<24; i++) {
+      sbusData[i] = 0;
+    }
+
+    // reset counters
+    ch = 0;
+    bit_in_servo = 0;
+    byte_in_sbus = 1;
+    bit_in_sbus = 0;
+
+    // store servo data
+    for (i=0; i<176; i++) {
+      if (servos[ch] & (1<<bit_in_servo)) {
+        sbusData[byte_in_sbus] |= (1<<bit_in_sbus);
+      }
+      bit_in_sbus++;
+      bit_in_servo++;
+
+      if (bit_in_sbus == 8) {
+        bit_in_sbus =0;
+        byte_in_sbus++;
+      }
+      if (bit_in_servo == 11) {
+        bit_in_servo =0;
+        ch++;
+      }
+    }
+
+    // DigiChannel 1
+    if (channels[16] == 1) {
+      sbusData[23] |= (1<<0);
+    }
+    // DigiChannel 2
+    if (channels[17] == 1) {
+      sbusData[23] |= (1<<1);
+    }
+
+    // Failsafe
+    if (failsafe_status == SBUS_SIGNAL_LOST) {
+      sbusData[23] |= (1<<2);
+    }
+
+    if (failsafe_status == SBUS_SIGNAL_FAILSAFE) {
+      sbusData[23] |= (1<<2);
+      sbusData[23] |= (1<<3);
+    }
+  }
+  // send data out
+  //serialPort.write(sbusData,25);
+  for (i=0;i<25;i++) {
+    SBUS_UART::write(sbusData[i]);
+  }
+}
+void FUTABA_SBUS::UpdateChannels(void) {
+  UpdateChannels<SBUS_DEFAULT_CHANNEL_MASK>();
+}
+bool FUTABA_SBUS::IsSyncByte(uint8_t data){
+  return data == CRSF_ADDRESS_FLIGHT_CONTROLLER || data == CRSF_ADDRESS_RADIO_TRANSMITTER ||
+         data == CRSF_ADDRESS_CRSF_RECEIVER || data == CRSF_ADDRESS_CRSF_TRANSMITTER;
+}
+
+const CRSF_FrameDispatch FUTABA_SBUS::frameHandlers[] PROGMEM = {
+  { CRSF_FRAMETYPE_RC_CHANNELS_PACKED, &FUTABA_SBUS::HandleRcChannels },
+  { CRSF_FRAMETYPE_LINK_STATISTICS, &FUTABA_SBUS::HandleLinkStatistics },
+  { CRSF_FRAMETYPE_SUBSET_RC_CHANNELS_PACKED, &FUTABA_SBUS::HandleSubsetRcChannels },
+  { CRSF_FRAMETYPE_COMMAND, &FUTABA_SBUS::HandleCommand },
+};
+
+bool FUTABA_SBUS::ProcessFrame(void){
+  // inBuffer holds [type][payload ...][crc], frameLength bytes in total.
+  // Frame types without a handler are skipped whole, keeping the parser in sync.
+  uint8_t type = inBuffer[0];
+  for (uint8_t i = 0; i < sizeof(frameHandlers) / sizeof(frameHandlers[0]); i++){
+    if (pgm_read_byte(&frameHandlers[i].type) == type){
+      CRSF_FrameDispatch entry;
+      memcpy_P(&entry, &frameHandlers[i], sizeof(entry));
+      return (this->*entry.handler)(&inBuffer[1], frameLength - 2);
+    }
+  }
+  return false;
+}
+
+bool FUTABA_SBUS::HandleRcChannels(const uint8_t *payload, uint8_t length){
+  if (length != CRSF_RC_CHANNELS_PACKED_PAYLOAD_SIZE){
+    return false;
+  }
+  rcPayload = payload;
+  frameTimestamp = syncStamp;
+  toChannels = 1;
+  return true;
+}
+
+bool FUTABA_SBUS::HandleSubsetRcChannels(const uint8_t *payload, uint8_t length){
+  // [config][channels ...]: config bits 0-4 first channel, bits 5-6 resolution
+  // (10 + n bits). Values are 1us steps from 988us scaled by the resolution;
+  // convert them to the 11-bit scale of the full frame (881us + 0.625us/tick).
+  if (length < 2){
+    return false;
+  }
+  uint8_t first = payload[0] & 0x1F;
+  uint8_t bits = 10 + ((payload[0] >> 5) & 0x03);
+  uint8_t count = ((length - 1) * 8) / bits;
+  uint16_t mask = (1 << bits) - 1;
+  uint32_t accumulator = 0;
+  uint8_t accumulated = 0;
+  const uint8_t *data = &payload[1];
+  for (uint8_t n = 0; n < count && first + n < 16; n++){
+    while (accumulated < bits){
+      accumulator |= (uint32_t)(*data++) << accumulated;
+      accumulated += 8;
+    }
+    uint16_t value = accumulator & mask;
+    accumulator >>= bits;
+    accumulated -= bits;
+    uint32_t tick = ((uint32_t)((value >> (bits - 10)) + 988 - 881) * 1639) >> 10;
+    channels[first + n] = tick > 0x07FF ? 0x07FF : tick;
+  }
+  // Channels are already decoded, UpdateChannels() has nothing left to unpack
+  rcPayload = NULL;
+  frameTimestamp = syncStamp;
+  toChannels = 1;
+  return true;
+}
+
+bool FUTABA_SBUS::HandleLinkStatistics(const uint8_t *payload, uint8_t length){
+  if (length < CRSF_LINK_STATISTICS_PAYLOAD_SIZE){
+    return false;
+  }
+  linkStatistics.uplinkRssi1 = payload[0];
+  linkStatistics.uplinkRssi2 = payload[1];
+  linkStatistics.uplinkLinkQuality = payload[2];
+  linkStatistics.uplinkSnr = (int8_t)payload[3];
+  linkStatistics.activeAntenna = payload[4];
+  linkStatistics.rfMode = payload[5];
+  linkStatistics.uplinkTxPower = payload[6];
+  linkStatistics.downlinkRssi = payload[7];
+  linkStatistics.downlinkLinkQuality = payload[8];
+  linkStatistics.downlinkSnr = (int8_t)payload[9];
+  linkStatisticsCount++;
+  // CRSF RC frames carry no failsafe flags; the receiver reports a dead
+  // uplink as zero link quality instead
+  failsafe_status = linkStatistics.uplinkLinkQuality == 0 ? SBUS_SIGNAL_FAILSAFE : SBUS_SIGNAL_OK;
+  return false;
+}
+
+bool FUTABA_SBUS::HandleCommand(const uint8_t *payload, uint8_t length){
+  // [dest][origin][command][sub command][data ...][command crc]
+  if (length < 5){
+    return false;
+  }
+  uint8_t destination = payload[0];
+  if (destination != CRSF_ADDRESS_FLIGHT_CONTROLLER && destination != 0x00){
+    return false;
+  }
+  // The command crc also covers the frame type byte
+  uint8_t commandCrc = crsf_crc8_command_update(0, CRSF_FRAMETYPE_COMMAND);
+  for (uint8_t i = 0; i < length - 1; i++){
+    commandCrc = crsf_crc8_command_update(commandCrc, payload[i]);
+  }
+  if (commandCrc != payload[length - 1]){
+    return false;
+  }
+  // Speed proposal: [port id][baud rate, big endian u32]
+  if (payload[2] == CRSF_COMMAND_GENERAL && payload[3] == CRSF_COMMAND_SPEED_PROPOSAL && length >= 10){
+    uint8_t portId = payload[4];
+    uint32_t baud = ((uint32_t)payload[5] << 24) | ((uint32_t)payload[6] << 16) |
+                    ((uint32_t)payload[7] << 8) | payload[8];
+    bool accepted = baud != 0 && SBUS_UART::baudErrorFor(baud) <= SBUS_UART_BAUD_ERROR_MAX;
+    // Reply at the current rate, then switch
+    SendSpeedResponse(payload[1], portId, accepted);
+    if (accepted){
+      SetBaudRate(baud);
+    }
+  }
+  return false;
+}
+
+void FUTABA_SBUS::SendSpeedResponse(uint8_t destination, uint8_t portId, bool accepted){
+  uint8_t frame[] = {
+    CRSF_ADDRESS_FLIGHT_CONTROLLER, 9, CRSF_FRAMETYPE_COMMAND,
+    destination, CRSF_ADDRESS_FLIGHT_CONTROLLER,
+    CRSF_COMMAND_GENERAL, CRSF_COMMAND_SPEED_RESPONSE, portId, (uint8_t)(accepted ? 1 : 0),
+    0, 0 };
+  uint8_t commandCrc = 0;
+  uint8_t crc = 0;
+  for (uint8_t i = 2; i < 9; i++){
+    commandCrc = crsf_crc8_command_update(commandCrc, frame[i]);
+  }
+  frame[9] = commandCrc;
+  for (uint8_t i = 2; i < 10; i++){
+    crc = crsf_crc8_update(crc, frame[i]);
+  }
+  frame[10] = crc;
+  for (uint8_t i = 0; i < sizeof(frame); i++){
+    SBUS_UART::write(frame[i]);
+  }
+}
+
+void FUTABA_SBUS::FeedLine(void){
+  // Consume whatever the RX interrupt has queued so far, never waiting for more.
+  // Byte-at-a-time state machine: hunt for a sync byte, validate the length,
+  // then collect type + payload + crc. Each byte is folded into the CRC8 as it
+  // arrives, and frames failing the check never reach ProcessFrame(). A bad
+  // length byte is itself re-examined as a sync candidate, so a glitch costs
+  // at most the frame it hit.
+  // Returns as soon as an RC frame has been latched so loop() can act on it.
+  while (SBUS_UART::read(inData, inStamp)){
+    switch (feedState){
+    case FEED_LENGTH:
+      if (inData >= CRSF_FRAME_LENGTH_MIN && inData <= CRSF_FRAME_LENGTH_MAX){
+        frameLength = inData;
+        frameCrc = 0;
+        bufferIndex = 0;
+        feedState = FEED_FRAME;
+        break;
+      }
+      // Not a frame after all: drop the sync byte and retry this one as sync
+      resyncCount++;
+      bytesDiscarded++;
+      feedState = FEED_SYNC;
+      // fall through
+    case FEED_SYNC:
+      if (IsSyncByte(inData)){
+        syncStamp = inStamp;
+        feedState = FEED_LENGTH;
+      }
+      else{
+        bytesDiscarded++;
+      }
+      break;
+    case FEED_FRAME:
+      inBuffer[bufferIndex++] = inData;
+      if (bufferIndex < frameLength){
+        frameCrc = crsf_crc8_update(frameCrc, inData);
+      }
+      else{
+        feedState = FEED_SYNC;
+        if (inData != frameCrc){
+          crcErrors++;
+        }
+        else if (ProcessFrame()){
+          return;
+        }
+      }
+      break;
+    }
+  }
+}
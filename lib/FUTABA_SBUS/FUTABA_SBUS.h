@@ -1,49 +1,176 @@
-
-#ifndef FUTABA_SBUS_h
-#define FUTABA_SBUS_h
-
-#include <Arduino.h>
-
-
-#define SBUS_SIGNAL_OK          0x00
-#define SBUS_SIGNAL_LOST        0x01
-#define SBUS_SIGNAL_FAILSAFE    0x03
-#define BAUDRATE 115200
-#define port Serial1
-#define ALL_CHANNELS 1
-
-
-class FUTABA_SBUS
-{
-	public:
-		uint8_t sbusData[25];
-		int16_t channels[18];
-		int16_t servos[18];
-		uint8_t  failsafe_status;
-		int sbus_passthrough;
-		int toChannels;
-		void begin(void);
-		int16_t Channel(uint8_t ch);
-		uint8_t DigiChannel(uint8_t ch);
-		void Servo(uint8_t ch, int16_t position);
-		void DigiServo(uint8_t ch, uint8_t position);
-		uint8_t Failsafe(void);
-		void PassthroughSet(int mode);
-		int PassthroughRet(void);
-		void UpdateServos(void);
-		void UpdateChannels(void);
-		void FeedLine(void);
-	private:
-		uint8_t byte_in_sbus;
-		uint8_t bit_in_sbus;
-		uint8_t ch;
-		uint8_t bit_in_channel;
-		uint8_t bit_in_servo;
-		uint8_t inBuffer[25];
-		int bufferIndex;
-		uint8_t inData;
-		int feedState;
-
-};
-
+
+#ifndef FUTABA_SBUS_h
+#define FUTABA_SBUS_h
+
+#include <Arduino.h>
+#include "SBUS_UART.h"
+#include "CRSF_CRC8.h"
+
+
+#define SBUS_SIGNAL_OK          0x00
+#define SBUS_SIGNAL_LOST        0x01
+#define SBUS_SIGNAL_FAILSAFE    0x03
+// Link baud rate at boot, override with e.g. -DBAUDRATE=400000 in build_flags.
+// The receiver can renegotiate it at runtime with a CRSF speed proposal.
+#ifndef BAUDRATE
+#define BAUDRATE 115200
+#endif
+
+// CRSF framing: [sync/address][length][type][payload ...][crc]
+// length counts type + payload + crc
+#define CRSF_ADDRESS_FLIGHT_CONTROLLER 0xC8
+#define CRSF_ADDRESS_RADIO_TRANSMITTER 0xEA
+#define CRSF_ADDRESS_CRSF_RECEIVER     0xEC
+#define CRSF_ADDRESS_CRSF_TRANSMITTER  0xEE
+#define CRSF_FRAME_SIZE_MAX            64
+#define CRSF_FRAME_LENGTH_MIN          2
+#define CRSF_FRAME_LENGTH_MAX          (CRSF_FRAME_SIZE_MAX - 2)
+#define CRSF_FRAMETYPE_LINK_STATISTICS 0x14
+#define CRSF_FRAMETYPE_RC_CHANNELS_PACKED 0x16
+#define CRSF_FRAMETYPE_SUBSET_RC_CHANNELS_PACKED 0x17
+#define CRSF_FRAMETYPE_COMMAND         0x32
+#define CRSF_LINK_STATISTICS_PAYLOAD_SIZE 10
+#define CRSF_RC_CHANNELS_PACKED_PAYLOAD_SIZE 22
+#define CRSF_COMMAND_GENERAL           0x0A
+#define CRSF_COMMAND_SPEED_PROPOSAL    0x70
+#define CRSF_COMMAND_SPEED_RESPONSE    0x71
+#define ALL_CHANNELS 1
+
+// Channel masks for UpdateChannels<Mask>(): bit n selects channels[n]
+#define SBUS_CHANNEL_MASK(ch) ((uint16_t)1 << (ch))
+#define SBUS_ALL_CHANNELS_MASK 0xFFFF
+#ifdef ALL_CHANNELS
+#define SBUS_DEFAULT_CHANNEL_MASK SBUS_ALL_CHANNELS_MASK
+#else
+#define SBUS_DEFAULT_CHANNEL_MASK 0x00FF
+#endif
+
+
+// CRSF link statistics frame (0x14), uplink is radio -> receiver
+struct CRSF_LinkStatistics
+{
+	uint8_t uplinkRssi1;        // dBm * -1
+	uint8_t uplinkRssi2;        // dBm * -1
+	uint8_t uplinkLinkQuality;  // %
+	int8_t  uplinkSnr;          // dB
+	uint8_t activeAntenna;
+	uint8_t rfMode;
+	uint8_t uplinkTxPower;
+	uint8_t downlinkRssi;       // dBm * -1
+	uint8_t downlinkLinkQuality; // %
+	int8_t  downlinkSnr;        // dB
+};
+
+class FUTABA_SBUS;
+
+// Frame handlers get the payload in place (after the type byte, before the
+// crc) and return true when the frame should be handed to loop() right away.
+typedef bool (FUTABA_SBUS::*CRSF_FrameHandler)(const uint8_t *payload, uint8_t length);
+
+struct CRSF_FrameDispatch
+{
+	uint8_t type;
+	CRSF_FrameHandler handler;
+};
+
+class FUTABA_SBUS
+{
+	public:
+		uint8_t sbusData[25];
+		int16_t channels[18];
+		int16_t servos[18];
+		uint8_t  failsafe_status; // SBUS_SIGNAL_FAILSAFE while link statistics report zero uplink quality
+		int sbus_passthrough;
+		int toChannels;
+		uint16_t frameTimestamp; // micros() & 0xFFFF of the first byte of the last frame
+		uint16_t resyncCount;    // frames abandoned because the length byte was invalid
+		uint32_t bytesDiscarded; // bytes skipped while hunting for a sync byte
+		uint16_t crcErrors;      // complete frames rejected by the CRC8 check
+		CRSF_LinkStatistics linkStatistics;
+		uint16_t linkStatisticsCount; // increments with every link statistics frame
+		void begin(void);
+		// Switch the link to a new baud rate; returns false (and keeps the
+		// current rate) if the USART cannot hit it within tolerance
+		bool SetBaudRate(uint32_t baud);
+		uint32_t BaudRate(void);
+		int16_t Channel(uint8_t ch);
+		uint8_t DigiChannel(uint8_t ch);
+		void Servo(uint8_t ch, int16_t position);
+		void DigiServo(uint8_t ch, uint8_t position);
+		uint8_t Failsafe(void);
+		void PassthroughSet(int mode);
+		int PassthroughRet(void);
+		void UpdateServos(void);
+		void UpdateChannels(void);
+		// Decode only the channels selected by Mask; the rest keep their old value
+		template <uint16_t Mask> void UpdateChannels(void);
+		// Parse queued link bytes. After an RC frame is latched (toChannels)
+		// the channel payload is decoded in place from the receive buffer, so
+		// call UpdateChannels() before the next FeedLine().
+		void FeedLine(void);
+
+		// Frame handlers, see CRSF_FrameDispatch
+		bool HandleRcChannels(const uint8_t *payload, uint8_t length);
+		bool HandleSubsetRcChannels(const uint8_t *payload, uint8_t length);
+		bool HandleLinkStatistics(const uint8_t *payload, uint8_t length);
+		bool HandleCommand(const uint8_t *payload, uint8_t length);
+	private:
+		static const CRSF_FrameDispatch frameHandlers[] PROGMEM;
+		enum { FEED_SYNC, FEED_LENGTH, FEED_FRAME };
+		static bool IsSyncByte(uint8_t data);
+		bool ProcessFrame(void);
+		void SendSpeedResponse(uint8_t destination, uint8_t portId, bool accepted);
+		uint8_t byte_in_sbus;
+		uint8_t bit_in_sbus;
+		uint8_t ch;
+		uint8_t bit_in_channel;
+		uint8_t bit_in_servo;
+		uint8_t inBuffer[CRSF_FRAME_LENGTH_MAX]; // type, payload and crc of the frame being received
+		uint8_t frameLength;
+		uint8_t frameCrc;        // running CRC8 of the frame being received
+		int bufferIndex;
+		uint8_t inData;
+		uint16_t inStamp;
+		uint16_t syncStamp;
+		int feedState;
+		uint32_t baudRate;
+		const uint8_t *rcPayload; // packed channels of the latched RC frame, NULL if already decoded
+
+};
+
+// Channel n occupies bits [11n, 11n + 11) of the 22-byte packed payload.
+// Byte index and shift are compile-time constants, so each selected channel
+// becomes a fixed two or three byte load/shift/or sequence.
+template <uint8_t Ch>
+inline int16_t SBUS_DecodeChannel(const uint8_t *data) {
+  enum { BIT = Ch * 11, BYTE = BIT / 8, SHIFT = BIT % 8 };
+  uint16_t value = (uint16_t)(data[BYTE] >> SHIFT) | (uint16_t)((uint16_t)data[BYTE + 1] << (8 - SHIFT));
+  if (SHIFT > 5) {
+    value |= (uint16_t)((uint16_t)data[BYTE + 2] << (16 - SHIFT));
+  }
+  return value & 0x07FF;
+}
+
+template <uint8_t Ch, uint16_t Mask>
+struct SBUS_ChannelUnpacker {
+  static inline void Unpack(const uint8_t *data, int16_t *channels) {
+    if (Mask & SBUS_CHANNEL_MASK(Ch)) {
+      channels[Ch] = SBUS_DecodeChannel<Ch>(data);
+    }
+    SBUS_ChannelUnpacker<Ch + 1, Mask>::Unpack(data, channels);
+  }
+};
+
+template <uint16_t Mask>
+struct SBUS_ChannelUnpacker<16, Mask> {
+  static inline void Unpack(const uint8_t *, int16_t *) {}
+};
+
+template <uint16_t Mask>
+void FUTABA_SBUS::UpdateChannels(void) {
+  if (rcPayload) {
+    SBUS_ChannelUnpacker<0, Mask>::Unpack(rcPayload, channels);
+  }
+}
+
 #endif
\ No newline at end of file
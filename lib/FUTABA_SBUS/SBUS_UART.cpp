@@ -0,0 +1,128 @@
+#include "SBUS_UART.h"
+
+uint32_t SBUS_UART::actual_baud = 0;
+uint16_t SBUS_UART::baud_error = 0;
+bool SBUS_UART::tx_written = false;
+volatile uint8_t SBUS_UART::rx_head = 0;
+volatile uint8_t SBUS_UART::rx_tail = 0;
+uint8_t SBUS_UART::rx_data[SBUS_UART_RX_BUFFER_SIZE];
+uint16_t SBUS_UART::rx_stamp[SBUS_UART_RX_BUFFER_SIZE];
+volatile uint16_t SBUS_UART::rx_overflows = 0;
+volatile uint16_t SBUS_UART::rx_errors = 0;
+
+static uint16_t errorOf(uint32_t baud, uint32_t actual){
+  uint32_t diff = actual > baud ? actual - baud : baud - actual;
+  return (uint16_t)((diff * 1000 + baud / 2) / baud);
+}
+
+uint16_t SBUS_UART::divisor(uint32_t baud, bool &doubleSpeed, uint32_t &actual){
+  // Rounded UBRR for both sample rates; keep normal speed on a tie since it
+  // samples each bit more often and tolerates more noise.
+  uint16_t best = 0;
+  uint16_t bestError = 0xFFFF;
+  for (uint8_t samples = 16; samples >= 8; samples -= 8) {
+    uint32_t ubrr = (F_CPU + (uint32_t)samples * baud / 2) / ((uint32_t)samples * baud);
+    if (ubrr > 0) {
+      ubrr--;
+    }
+    if (ubrr > 4095) {
+      ubrr = 4095;
+    }
+    uint32_t rate = F_CPU / ((uint32_t)samples * (ubrr + 1));
+    uint16_t error = errorOf(baud, rate);
+    if (error < bestError) {
+      best = ubrr;
+      bestError = error;
+      doubleSpeed = (samples == 8);
+      actual = rate;
+    }
+  }
+  return best;
+}
+
+uint16_t SBUS_UART::baudErrorFor(uint32_t baud){
+  bool doubleSpeed;
+  uint32_t actual;
+  divisor(baud, doubleSpeed, actual);
+  return errorOf(baud, actual);
+}
+
+void SBUS_UART::begin(uint32_t baud){
+  bool doubleSpeed = false;
+  uint16_t ubrr = divisor(baud, doubleSpeed, actual_baud);
+  baud_error = errorOf(baud, actual_baud);
+
+  UCSR1B = 0;
+  UCSR1A = doubleSpeed ? _BV(U2X1) : 0;
+  UBRR1 = ubrr;
+  tx_written = false;
+
+  rx_head = 0;
+  rx_tail = 0;
+
+  // 8N1, receiver with interrupt, transmitter polled
+  UCSR1C = _BV(UCSZ11) | _BV(UCSZ10);
+  UCSR1B = _BV(RXEN1) | _BV(TXEN1) | _BV(RXCIE1);
+}
+
+void SBUS_UART::end(void){
+  UCSR1B = 0;
+}
+
+uint8_t SBUS_UART::available(void){
+  return (uint8_t)(rx_head - rx_tail) & SBUS_UART_RX_BUFFER_MASK;
+}
+
+bool SBUS_UART::read(uint8_t &data, uint16_t &timestamp){
+  uint8_t tail = rx_tail;
+  if (tail == rx_head) {
+    return false;
+  }
+  // Copy the slot out, then publish it back to the ISR, with interrupts off
+  // so neither the two-byte timestamp nor the stores can be split or reordered
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    data = rx_data[tail];
+    timestamp = rx_stamp[tail];
+    rx_tail = (tail + 1) & SBUS_UART_RX_BUFFER_MASK;
+  }
+  return true;
+}
+
+void SBUS_UART::write(uint8_t data){
+  while (!(UCSR1A & _BV(UDRE1))) {
+  }
+  UDR1 = data;
+  // Clear TXC1 (write one) so flush() can tell when this byte is out
+  UCSR1A = (UCSR1A & _BV(U2X1)) | _BV(TXC1);
+  tx_written = true;
+}
+
+void SBUS_UART::flush(void){
+  if (!tx_written) {
+    return;
+  }
+  while (!(UCSR1A & _BV(UDRE1)) || !(UCSR1A & _BV(TXC1))) {
+  }
+}
+
+void SBUS_UART::receive(uint8_t data, uint8_t status){
+  if (status & (_BV(FE1) | _BV(DOR1))) {
+    rx_errors++;
+  }
+  uint8_t head = rx_head;
+  uint8_t next = (head + 1) & SBUS_UART_RX_BUFFER_MASK;
+  if (next == rx_tail) {
+    rx_overflows++;
+    return;
+  }
+  rx_data[head] = data;
+  rx_stamp[head] = (uint16_t)micros();
+  rx_head = next;
+}
+
+ISR(USART1_RX_vect)
+{
+  // Status must be read before UDR1, reading UDR1 clears the error flags
+  uint8_t status = UCSR1A;
+  SBUS_UART::receive(UDR1, status);
+}
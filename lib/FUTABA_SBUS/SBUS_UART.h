@@ -0,0 +1,87 @@
+#ifndef SBUS_UART_h
+#define SBUS_UART_h
+
+#include <Arduino.h>
+#include <util/atomic.h>
+
+// Interrupt-driven receive path for the receiver link on USART1.
+//
+// The USART1 RX interrupt pushes every byte, together with the low 16 bits of
+// micros() at reception, into a single-producer/single-consumer ring. loop()
+// drains it with read(), which never blocks. Head is only written by the ISR
+// and tail only by the consumer; both are single bytes so they need no locking.
+// The 16-bit timestamp and error counters are read with interrupts off.
+//
+// This replaces Serial1 entirely: HardwareSerial defines its own USART1 ISR,
+// so Serial1 must not be referenced anywhere else in the sketch.
+
+// Must be a power of two, at most 256. 128 holds 127 bytes: two full-size
+// frames, or about 0.6 ms of back-to-back bytes at 2000000 baud.
+#define SBUS_UART_RX_BUFFER_SIZE 128
+#define SBUS_UART_RX_BUFFER_MASK (SBUS_UART_RX_BUFFER_SIZE - 1)
+
+#if (SBUS_UART_RX_BUFFER_SIZE & SBUS_UART_RX_BUFFER_MASK) != 0 || SBUS_UART_RX_BUFFER_SIZE > 256
+#error SBUS_UART_RX_BUFFER_SIZE must be a power of two no larger than 256
+#endif
+
+// Largest baud error, in tenths of a percent, accepted for the link. 8N1
+// tolerates roughly +-2%; this is set just above the 2.1% every 16 MHz AVR
+// has always run 115200 at.
+#define SBUS_UART_BAUD_ERROR_MAX 25
+
+class SBUS_UART
+{
+	public:
+		// Programs UBRR1, choosing normal or double speed (U2X) mode, whichever
+		// lands closer to the requested rate. On a 16 MHz 32u4 115200 (2.1%),
+		// 400000, 1000000 and 2000000 are usable; 420000 ends up at 400000 (4.8%)
+		// and 921600 at 1000000 (8.5%), which is outside tolerance, so configure
+		// the receiver for 400000 rather than 420000 where possible.
+		static void begin(uint32_t baud);
+		static void end(void);
+		// Actual rate and its error (tenths of a percent) for the last begin()
+		static uint32_t actualBaud(void) { return actual_baud; }
+		static uint16_t baudError(void) { return baud_error; }
+		// Error the given rate would have, without touching the hardware
+		static uint16_t baudErrorFor(uint32_t baud);
+
+		// Bytes waiting in the receive ring
+		static uint8_t available(void);
+		// Pop one byte and its reception timestamp (micros() & 0xFFFF).
+		// Returns false when the ring is empty.
+		static bool read(uint8_t &data, uint16_t &timestamp);
+		// Blocking single-byte transmit (telemetry/servo output only)
+		static void write(uint8_t data);
+		// Wait until the last written byte has left the shift register
+		static void flush(void);
+
+		// Bytes lost because the ring was full
+		static uint16_t rxOverflows(void) {
+			uint16_t count;
+			ATOMIC_BLOCK(ATOMIC_RESTORESTATE) { count = rx_overflows; }
+			return count;
+		}
+		// Bytes received with a framing/overrun error flagged by the USART
+		static uint16_t rxErrors(void) {
+			uint16_t count;
+			ATOMIC_BLOCK(ATOMIC_RESTORESTATE) { count = rx_errors; }
+			return count;
+		}
+
+		// ISR side, do not call directly
+		static void receive(uint8_t data, uint8_t status);
+
+	private:
+		static uint16_t divisor(uint32_t baud, bool &doubleSpeed, uint32_t &actual);
+		static uint32_t actual_baud;
+		static uint16_t baud_error;
+		static bool tx_written;
+		static volatile uint8_t rx_head;
+		static volatile uint8_t rx_tail;
+		static uint8_t rx_data[SBUS_UART_RX_BUFFER_SIZE];
+		static uint16_t rx_stamp[SBUS_UART_RX_BUFFER_SIZE];
+		static volatile uint16_t rx_overflows;
+		static volatile uint16_t rx_errors;
+};
+
+#endif
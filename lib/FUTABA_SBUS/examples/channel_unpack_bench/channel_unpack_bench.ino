@@ -0,0 +1,104 @@
+#include <FUTABA_SBUS.h>
+
+// Cycle counts for unpacking a CRSF channel payload three ways: the
+// hand-written shifts the library used before (all 16 channels, kept here as
+// the reference), the template unpack of all 16 channels, and a masked unpack
+// of the nine channels the ELRSController firmware reads.
+//
+// Timing: Timer1 runs at F_CPU with no prescaler, so each tick is one CPU
+// cycle, and interrupts are off while a variant runs so the USB interrupt
+// cannot land inside the measurement. Results print over USB serial, which is
+// only touched outside the timed sections. Other benchmark sketches in this
+// project time the same way.
+
+#define BENCH_MASK 0x01FF
+#define BENCH_RUNS 256
+
+static uint8_t payload[CRSF_RC_CHANNELS_PACKED_PAYLOAD_SIZE];
+static int16_t channels[16];
+static int16_t reference[16];
+
+static uint16_t cycles_legacy;
+static uint16_t cycles_full;
+static uint16_t cycles_masked;
+static uint16_t mismatches;
+
+// The decoder FUTABA_SBUS::UpdateChannels() used before the template unpack;
+// d[0] is the first payload byte (sbusData[1] in the old frame buffer)
+static void legacyUnpack(const uint8_t *d, int16_t *ch){
+  ch[0]  = ((d[0]|d[1]<< 8) & 0x07FF);
+  ch[1]  = ((d[1]>>3|d[2]<<5) & 0x07FF);
+  ch[2]  = ((d[2]>>6|d[3]<<2|d[4]<<10) & 0x07FF);
+  ch[3]  = ((d[4]>>1|d[5]<<7) & 0x07FF);
+  ch[4]  = ((d[5]>>4|d[6]<<4) & 0x07FF);
+  ch[5]  = ((d[6]>>7|d[7]<<1|d[8]<<9) & 0x07FF);
+  ch[6]  = ((d[8]>>2|d[9]<<6) & 0x07FF);
+  ch[7]  = ((d[9]>>5|d[10]<<3) & 0x07FF);
+  ch[8]  = ((d[11]|d[12]<< 8) & 0x07FF);
+  ch[9]  = ((d[12]>>3|d[13]<<5) & 0x07FF);
+  ch[10] = ((d[13]>>6|d[14]<<2|d[15]<<10) & 0x07FF);
+  ch[11] = ((d[15]>>1|d[16]<<7) & 0x07FF);
+  ch[12] = ((d[16]>>4|d[17]<<4) & 0x07FF);
+  ch[13] = ((d[17]>>7|d[18]<<1|d[19]<<9) & 0x07FF);
+  ch[14] = ((d[19]>>2|d[20]<<6) & 0x07FF);
+  ch[15] = ((d[20]>>5|d[21]<<3) & 0x07FF);
+}
+
+static uint16_t timeLegacy(){
+  uint8_t sreg = SREG;
+  cli();
+  TCNT1 = 0;
+  legacyUnpack(payload, reference);
+  uint16_t t = TCNT1;
+  SREG = sreg;
+  return t;
+}
+
+template <uint16_t Mask>
+static uint16_t timeUnpack(){
+  uint8_t sreg = SREG;
+  cli();
+  TCNT1 = 0;
+  SBUS_ChannelUnpacker<0, Mask>::Unpack(payload, channels);
+  uint16_t t = TCNT1;
+  SREG = sreg;
+  return t;
+}
+
+void setup(){
+  Serial.begin(115200);
+  while (!Serial) {
+  }
+  TCCR1A = 0;
+  TCCR1B = _BV(CS10);
+
+  uint32_t legacy = 0;
+  uint32_t full = 0;
+  uint32_t masked = 0;
+  for (int i = 0; i < BENCH_RUNS; i++){
+    for (uint8_t b = 0; b < sizeof(payload); b++){
+      payload[b] = random(256);
+    }
+    legacy += timeLegacy();
+    full += timeUnpack<SBUS_ALL_CHANNELS_MASK>();
+    if (memcmp(channels, reference, sizeof(channels)) != 0){
+      mismatches++;
+    }
+    masked += timeUnpack<BENCH_MASK>();
+  }
+  cycles_legacy = legacy / BENCH_RUNS;
+  cycles_full = full / BENCH_RUNS;
+  cycles_masked = masked / BENCH_RUNS;
+}
+
+void loop(){
+  Serial.print("hand-written unpack: ");
+  Serial.print(cycles_legacy);
+  Serial.print(" cycles, full unpack: ");
+  Serial.print(cycles_full);
+  Serial.print(" cycles, masked unpack: ");
+  Serial.print(cycles_masked);
+  Serial.print(" cycles, mismatches: ");
+  Serial.println(mismatches);
+  delay(1000);
+}
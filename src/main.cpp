@@ -1,7 +1,15 @@
 #include <Arduino.h>
-#include <Joystick.h>
+#include <StaticJoystick.h>
 #include <FUTABA_SBUS.h>
-#include "utils/SBusTracker.h"
+#include "utils/MultiChannelTracker.h"
+#include "utils/Failsafe.h"
+#include "utils/FilterPipeline.h"
+#include "utils/SwitchDecoder.h"
+#include "utils/FrameRate.h"
+#include "utils/AlphaBetaPredictor.h"
+#include "utils/SpikeFilter.h"
+#include "utils/Calibration.h"
+#include "utils/ResponseCurveTables.h"
 // #include <Streaming.h>
 
 
@@ -10,7 +18,7 @@
 // For PlatformIO add this to your environment in `platformio.ini`:
 //
 // [env:your_env]
-// build_flags = -DDEBUG_LOG
+// build_flags = -std=gnu++14 -DDEBUG_LOG
 //
 // Note: On some boards the Serial interface may conflict with USB HID functionality
 // (e.g., when emulating a joystick). Only enable serial debug while testing.
@@ -24,15 +32,79 @@
 #define DEBUG_PRINTLN(val) do {} while (0)
 #endif
 
-#define MIN_SIGNAL 190
-#define MAX_SIGNAL 1790
+// Frame cycle profiling, separate from logging: with `-DFRAME_CYCLES` added
+// to a DEBUG_LOG build, the CPU cycles loop() spends turning a frame into a
+// report (calibration, filters, thresholds and report building) are counted
+// and their average printed with the other statistics. This takes over
+// Timer1, free-running at one tick per cycle, so leave it off otherwise.
+#if defined(FRAME_CYCLES)
+#if !defined(DEBUG_LOG)
+#error FRAME_CYCLES prints through the debug log, define DEBUG_LOG as well
+#endif
+#define FRAME_CYCLES_SETUP() do { TCCR1A = 0; TCCR1B = _BV(CS10); } while (0)
+#define FRAME_CYCLES_BEGIN() uint16_t frameCyclesStart = TCNT1
+#define FRAME_CYCLES_END() frameCycles += (uint16_t)(TCNT1 - frameCyclesStart) // one wrap is 4 ms at 16 MHz
+#else
+#define FRAME_CYCLES_SETUP() do {} while (0)
+#define FRAME_CYCLES_BEGIN() do {} while (0)
+#define FRAME_CYCLES_END() do {} while (0)
+#endif
+
+// Values reported on every axis while in failsafe (stick centre / switch MID)
+#define FAILSAFE_XAXIS 992
+#define FAILSAFE_YAXIS 992
+#define FAILSAFE_RXAXIS 992
+#define FAILSAFE_RYAXIS 992
+#define FAILSAFE_THROTTLE 992
+#define FAILSAFE_RUDDER 992
 
 #define ACTIVE_SIGNAL 1792
 #define RELEASED_SIGNAL 192
-#define MAJORITY_THRESH ( (HISTORY_SIZE / 2 + 1) * ACTIVE_SIGNAL) / HISTORY_SIZE
 
-#define EMA_ALPHA 0.12f // tuned: slightly more smoothing for stability
-#define DEBOUNCE_COUNT 3 // tuned: require 3 consecutive confirmations to change mode
+// Moving-average windows in milliseconds, tuned as 9 and 4 frames at 250 Hz.
+// The trackers use as many frames as cover the window at the measured frame
+// rate, up to TRACKER_SAMPLES_MAX (16): above 444 Hz the switch window is
+// 16 frames rather than 36 ms. Stick axes use a short window: spikes are
+// rejected up front.
+#define SWITCH_WINDOW_MS 36
+#define AXIS_WINDOW_MS 16
+
+// Switch samples are kept as 8-bit values in 8-count steps: they only feed
+// the position thresholds and the three-level throttle/rudder. With the axis
+// tracker compiled out that is 98 B of tracker SRAM, down from 198 B for the
+// nine int trackers this replaced.
+#define SWITCH_SAMPLE_SHIFT 3
+
+// Average a button needs to pass to be ON: a strict majority of the switch
+// window's frames at ACTIVE_SIGNAL. Follows the window length in retime_trackers().
+constexpr unsigned int majority_threshold(uint8_t frames) {
+  return ((frames / 2 + 1) * (unsigned long)ACTIVE_SIGNAL) / frames;
+}
+static unsigned int majorityThreshold;
+
+// Fastest physically possible movement, counts per millisecond
+#define STICK_SLEW_PER_MS 64 // a full stick sweep in ~25 ms
+#define SWITCH_SLEW_PER_MS 8 // switches jump; every jump waits one frame for confirmation
+
+// Speed-adaptive smoothing for stick axes (AdaptiveEma): ~0.05 at rest, fully
+// open once the stick moves ~30 counts per frame
+#define AXIS_MIN_ALPHA_Q8 13
+#define AXIS_BETA_Q8 8
+
+// Alpha-beta predictor gains for AXIS_PREDICTED axes (0.7 / 0.31). Picked on
+// synthetic traces (test/test_alpha_beta); not yet checked on recorded captures.
+#define PREDICT_ALPHA_Q8 179
+#define PREDICT_BETA_Q8 80
+
+// Holding L, R and SE buttons on this long enters calibration; holding them again saves it
+#define CALIBRATION_HOLD_MS 3000
+
+#define REPORT_STATS_INTERVAL 500 // frames between reports-per-frame debug prints
+
+// Switch filter constants in milliseconds, converted to per-frame coefficients
+// for the measured packet rate. Tuned as alpha 0.12 and 3 frames at 250 Hz.
+#define EMA_TAU_MS 29 // tuned: slightly more smoothing for stability
+#define DEBOUNCE_MS 12 // tuned: a new mode must hold this long before it is committed
 
 #define XAXIS_CHANNEL 3
 #define YAXIS_CHANNEL 2
@@ -44,201 +116,115 @@
 #define RBUTTON_CHANNEL 7
 #define SE_BUTTON_CHANNEL 8
 
-enum TriSwitchMode
-{
-    DOWN = 0,
-    MID = 1,
-    UP = 2,
-};
+// Channel tables: slot order of the averaging trackers -> frame channel
+enum AxisSlot { X_SLOT, Y_SLOT, RX_SLOT, RY_SLOT, AXIS_SLOTS };
+constexpr uint8_t axisChannels[AXIS_SLOTS] = { XAXIS_CHANNEL, YAXIS_CHANNEL, RX_CHANNEL, RY_CHANNEL };
 
-enum ButtonMode
-{
-    OFF = 0,
-    ON = 1,
-};
+// Switch slots; their channels and filters are declared in SwitchFilters
+enum SwitchSlot { L_TRI_SLOT, R_TRI_SLOT, L_BUT_SLOT, R_BUT_SLOT, SE_BUT_SLOT, SWITCH_SLOTS };
+
+// Only the channels in the tables are unpacked from each frame
+#define USED_CHANNELS_MASK (channel_table_mask(axisChannels, AXIS_SLOTS) | channel_table_mask(SwitchFilters::channels, SWITCH_SLOTS))
+
+// Signal range thresholds are written against and the joystick axes span:
+// the range Calibration maps every channel onto. Normalized -1.0 .. 1.0, with
+// the positive and negative halves scaled separately around center.
+#define SIGNAL_LOW CALIBRATION_OUT_LOW
+#define SIGNAL_CENTER CALIBRATION_OUT_CENTER
+#define SIGNAL_HIGH CALIBRATION_OUT_HIGH
+
+// Raw count where the normalized value crosses `n`, evaluated by the compiler
+// so thresholds can be written in normalized units but compared as integers.
+constexpr double norm_to_signal(double n) {
+    return SIGNAL_CENTER + n * (n >= 0 ? (SIGNAL_HIGH - SIGNAL_CENTER) : (SIGNAL_CENTER - SIGNAL_LOW));
+}
+// Largest raw value still at or below `n`: v normalizes above n  <=>  v > signal_above(n)
+constexpr int signal_above(double n) {
+    return static_cast<int>(norm_to_signal(n));
+}
+// Smallest raw value still at or above `n`: v normalizes below n  <=>  v < signal_below(n)
+constexpr int signal_below(double n) {
+    return static_cast<int>(norm_to_signal(n)) + (norm_to_signal(n) > static_cast<int>(norm_to_signal(n)) ? 1 : 0);
+}
 
 struct Translation
 {
-    double normalize(int analogValue);
-    TriSwitchMode getTriSwitchMode(int TriVal);
     ButtonMode get_button_state(int estimated);
 };
 
 // TRANSLATION
-double Translation::normalize(int analogValue) 
-{
-    if (analogValue > 1800)
-        analogValue = 1800;
-    if (analogValue < 174)
-        analogValue = 174;
-    analogValue -= 992;
-    return analogValue >= 0 ? (double(analogValue) / (1800 - 992))
-                            : (double(analogValue) / (992 - 174));
-}
-TriSwitchMode Translation::getTriSwitchMode(int TriVal)
-{
-    double TriVal_norm = normalize(TriVal);
-    if (TriVal_norm < -0.5)
-        return DOWN;
-    else if (TriVal_norm > 0.4)
-        return UP;
-    else
-        return MID;
-}
 ButtonMode Translation::get_button_state(int estimated) {
-    if (estimated > MAJORITY_THRESH) {
+    if (estimated > (int)majorityThreshold) {
       return ON;
     } else {
       return OFF;
     }
 }
 
-// Hysteresis for tri-switch mode to prevent flapping near thresholds
-static TriSwitchMode lastLMode = MID;
-static TriSwitchMode lastRMode = MID;
-// Debounce counters for confirming a new mode before committing
-static int l_mode_counter = 0;
-static int r_mode_counter = 0;
-
-// Median-of-3 buffers for L and R raw samples
-static long l_raw_buf[3] = {0};
-static long r_raw_buf[3] = {0};
-static int l_raw_idx = 0;
-static int r_raw_idx = 0;
-
-// Exit confirmation counters: require several consecutive exit samples to leave UP/DOWN
-static int l_exit_counter = 0;
-static int r_exit_counter = 0;
-
-// Button hysteresis/debounce state (use normalized values like tri-switches)
-static ButtonMode l_button_state = OFF;
-static ButtonMode r_button_state = OFF;
-static int l_button_mode_counter = 0;
-static int r_button_mode_counter = 0;
-static int l_button_exit_counter = 0;
-static int r_button_exit_counter = 0;
-
-// Button thresholds (normalized), same pattern as tri-switch
-const static double button_enter = 0.20;
-const static double button_exit = -0.20;
-
-// Update a binary button using normalized input with enter/exit hysteresis and DEBOUNCE_COUNT
-static ButtonMode update_button_hysteresis(Translation &translator, int estimated,
-                                           ButtonMode &state, int &mode_counter, int &exit_counter,
-                                           const char *name) {
-  double n = translator.normalize(estimated);
-  ButtonMode old = state;
-  if (state == ON) {
-    if (n < button_exit) {
-      if (++exit_counter >= DEBOUNCE_COUNT) {
-        state = OFF;
-        exit_counter = 0;
-      }
-    } else {
-      exit_counter = 0;
-    }
-  } else { // OFF
-    if (n > button_enter) {
-      if (++mode_counter >= DEBOUNCE_COUNT) {
-        state = ON;
-        mode_counter = 0;
-      }
-    } else {
-      mode_counter = 0;
+// Button thresholds (normalized +0.20/-0.20, same pattern as tri-switch) as raw counts
+constexpr static int button_enter = signal_above(0.20);
+constexpr static int button_exit = signal_below(-0.20);
+
+// Tri-switch thresholds, given in normalized units and compared as raw
+// counts; UP needs a clearer drop (0.15) to exit than to enter (0.45).
+constexpr SwitchProfile triSwitchProfile = tri_switch_profile(signal_above(0.45), signal_below(0.15),
+                                                              signal_below(-0.55), signal_above(-0.15), DEBOUNCE_MS);
+constexpr SwitchProfile buttonProfile = button_profile(button_enter, button_exit, DEBOUNCE_MS);
+
+// Per-channel filter chains, run on the switch tracker estimates ahead of the switch decoders
+typedef Pipeline<EmaMs<EMA_TAU_MS>, Median<3>> TriSwitchFilter;
+typedef Pipeline<> ButtonFilter;
+typedef Pipeline<EmaMs<EMA_TAU_MS>> SEButtonFilter;
+
+// Stick smoothing, chosen per axis: AXIS_ADAPTIVE runs the raw channel through
+// AxisFilter, AXIS_AVERAGED reports the axisTracker moving average and
+// AXIS_PREDICTED tracks the raw channel with an alpha-beta filter and
+// extrapolates it to the time the report is sent
+enum AxisSmoothing { AXIS_AVERAGED, AXIS_ADAPTIVE, AXIS_PREDICTED };
+constexpr AxisSmoothing axisSmoothing[AXIS_SLOTS] = { AXIS_ADAPTIVE, AXIS_ADAPTIVE, AXIS_ADAPTIVE, AXIS_ADAPTIVE };
+constexpr bool axis_smoothing_used(AxisSmoothing smoothing) {
+  for (uint8_t slot = 0; slot < AXIS_SLOTS; slot++) {
+    if (axisSmoothing[slot] == smoothing) {
+      return true;
     }
   }
-  if (state != old) {
-#if defined(DEBUG_LOG)
-    DEBUG_PRINT(name); DEBUG_PRINT(" button: "); DEBUG_PRINT(old == OFF ? "OFF" : "ON"); DEBUG_PRINT(" -> "); DEBUG_PRINTLN(state == OFF ? "OFF" : "ON");
-#endif
-  }
-  return state;
+  return false;
 }
-
-TriSwitchMode getTriSwitchModeWithHysteresis(Translation &translator, long rawValue, TriSwitchMode &lastMode) {
-  double n = translator.normalize(static_cast<int>(rawValue));
-  // thresholds tuned relative to Translation::getTriSwitchMode thresholds
-  const static double up_enter = 0.45;
-  const static double up_exit = 0.15; // tuned: require a clearer drop to exit UP
-  const static double down_enter = -0.55;
-  const static double down_exit = -0.15;
-
-  if (lastMode == UP) {
-    // pick correct exit counter for this switch
-    int *exit_counter = nullptr;
-    if (&lastMode == &lastLMode) exit_counter = &l_exit_counter;
-    else if (&lastMode == &lastRMode) exit_counter = &r_exit_counter;
-
-    if (n < up_exit) {
-      // require consecutive exit confirmations
-      if (exit_counter) {
-        if (++(*exit_counter) >= DEBOUNCE_COUNT) {
-          lastMode = MID;
-          *exit_counter = 0;
-        }
-      } else {
-        // fallback: immediate
-        lastMode = MID;
-      }
-    } else {
-      if (exit_counter) *exit_counter = 0;
-    }
-    return lastMode;
-  }
-  if (lastMode == DOWN) {
-    // pick correct exit counter for this switch
-    int *exit_counter = nullptr;
-    if (&lastMode == &lastLMode) exit_counter = &l_exit_counter;
-    else if (&lastMode == &lastRMode) exit_counter = &r_exit_counter;
-
-    if (n > down_exit) {
-      if (exit_counter) {
-        if (++(*exit_counter) >= DEBOUNCE_COUNT) {
-          lastMode = MID;
-          *exit_counter = 0;
-        }
-      } else {
-        lastMode = MID;
-      }
-    } else {
-      if (exit_counter) *exit_counter = 0;
-    }
-    return lastMode;
+typedef Pipeline<AdaptiveEma<AXIS_MIN_ALPHA_Q8, AXIS_BETA_Q8>> AxisFilter;
+typedef AlphaBetaPredictor<PREDICT_ALPHA_Q8, PREDICT_BETA_Q8> AxisPredictor;
+
+// Switch channel table, one row per SwitchSlot: the frame channel, the chain
+// run on its tracker estimate and the profile it is then decoded with. SE is
+// not decoded: its smoothed value is held against the majority threshold.
+typedef FilterBank<
+  FilterSlot<L_TRI_SWITCH_CHANNEL, TriSwitchFilter, &triSwitchProfile>,
+  FilterSlot<R_TRI_SWITCH_CHANNEL, TriSwitchFilter, &triSwitchProfile>,
+  FilterSlot<LBUTTON_CHANNEL, ButtonFilter, &buttonProfile>,
+  FilterSlot<RBUTTON_CHANNEL, ButtonFilter, &buttonProfile>,
+  FilterSlot<SE_BUTTON_CHANNEL, SEButtonFilter>>
+  SwitchFilters;
+static_assert(SwitchFilters::size == SWITCH_SLOTS, "one SwitchFilters row per SwitchSlot");
+
+// Spike rejection covers every used channel, sticks first, then switches,
+// built from the two channel tables
+#define SPIKE_SLOTS (AXIS_SLOTS + SWITCH_SLOTS)
+struct SpikeTable {
+  uint8_t channels[SPIKE_SLOTS];
+  uint8_t slew[SPIKE_SLOTS];
+};
+constexpr SpikeTable spike_table() {
+  SpikeTable table = {};
+  for (uint8_t slot = 0; slot < AXIS_SLOTS; slot++) {
+    table.channels[slot] = axisChannels[slot];
+    table.slew[slot] = STICK_SLEW_PER_MS;
   }
-
-  // lastMode == MID
-  // Candidate mode based on thresholds
-  TriSwitchMode candidate;
-  if (n > up_enter) {
-    candidate = UP;
-  } else if (n < down_enter) {
-    candidate = DOWN;
-  } else {
-    candidate = MID;
+  for (uint8_t slot = 0; slot < SWITCH_SLOTS; slot++) {
+    table.channels[AXIS_SLOTS + slot] = SwitchFilters::channels[slot];
+    table.slew[AXIS_SLOTS + slot] = SWITCH_SLEW_PER_MS;
   }
-
-  // Debounce: require DEBOUNCE_COUNT consecutive candidate readings before committing
-  int *counter = nullptr;
-  if (&lastMode == &lastLMode) counter = &l_mode_counter;
-  else if (&lastMode == &lastRMode) counter = &r_mode_counter;
-
-  if (counter) {
-    if (candidate == lastMode) {
-      *counter = 0; // already in this mode
-    } else {
-      (*counter)++;
-      if (*counter >= DEBOUNCE_COUNT) {
-        lastMode = candidate;
-        *counter = 0;
-      }
-    }
-  } else {
-    // Fallback: commit immediately
-    lastMode = candidate;
-  }
-
-  return lastMode;
+  return table;
 }
+constexpr SpikeTable spikeTable = spike_table();
 
 // Helper to convert mode to human-readable string for debug logging
 static const char* triModeToString(TriSwitchMode m) {
@@ -250,69 +236,46 @@ static const char* triModeToString(TriSwitchMode m) {
   }
 }
 
-// Variant with debug logging (prints when the mode changes). Name is used to indicate L/R switch.
-// Helper to compute normalized value for logging
-static double normalize_for_log(Translation &translator, long rawValue) {
-  return translator.normalize(static_cast<int>(rawValue));
-}
-
-TriSwitchMode getTriSwitchModeWithHysteresis(Translation &translator, long rawValue, TriSwitchMode &lastMode, const char* name) {
-  TriSwitchMode oldMode = lastMode;
-  TriSwitchMode newMode = getTriSwitchModeWithHysteresis(translator, rawValue, lastMode);
-  if (newMode != oldMode) {
-    double n = normalize_for_log(translator, rawValue);
-    DEBUG_PRINT(name);
-    DEBUG_PRINT(" change: ");
-    DEBUG_PRINT(triModeToString(oldMode));
-    DEBUG_PRINT(" -> ");
-    DEBUG_PRINT(triModeToString(newMode));
-    DEBUG_PRINT(" | raw=");
-    DEBUG_PRINT(rawValue);
-    DEBUG_PRINT(" norm=");
-    DEBUG_PRINTLN(n);
-  }
-  return newMode;
-}
-
-// Exponential Moving Average (IIR) helper
-// alpha: smoothing factor in (0,1). Smaller alpha = more smoothing.
-static float l_est_ema = 0.0f;
-static float r_est_ema = 0.0f;
-static float se_est_ema = 0.0f;
-static bool l_est_ema_init = false;
-static bool r_est_ema_init = false;
-static bool se_est_ema_init = false;
-
-static long ema_update(float &state, bool &inited, const float alpha, long sample) {
-  if (!inited) {
-    state = (float)sample;
-    inited = true;
-  } else {
-    state = alpha * (float)sample + (1.0f - alpha) * state;
+static const char* positionToString(const SwitchProfile *profile, uint8_t position) {
+  if (profile->positions == 3) {
+    return triModeToString(static_cast<TriSwitchMode>(position));
   }
-  return (long)(state + 0.5f);
+  return position == OFF ? "OFF" : "ON";
 }
 
 Translation Map;
 
-Joystick_ Joystick(JOYSTICK_DEFAULT_REPORT_ID,JOYSTICK_TYPE_MULTI_AXIS,
-  11, 0,                  // Button Count, Hat Switch Count
-  true, true, false,     // X and Y, but no Z Axis
-  true, true, false,   // No Rx, Ry, or Rz
-  true, true,          // No rudder or throttle
-  false, false, false);  // No accelerator, brake, or steering
+// Descriptor and report layout are fixed at compile time; the report is
+// 11 buttons, X, Y, Rx, Ry, then rudder and throttle, as my_joystick.py expects
+typedef JoystickConfig<JOYSTICK_DEFAULT_REPORT_ID, JOYSTICK_TYPE_MULTI_AXIS,
+  11, 0,                                          // Button Count, Hat Switch Count
+  JOYSTICK_INCLUDE_X_AXIS | JOYSTICK_INCLUDE_Y_AXIS
+    | JOYSTICK_INCLUDE_RX_AXIS | JOYSTICK_INCLUDE_RY_AXIS, // No Z or Rz
+  JOYSTICK_INCLUDE_RUDDER | JOYSTICK_INCLUDE_THROTTLE>    // No accelerator, brake, or steering
+  GamepadConfig;
 
-FUTABA_SBUS sBus;
+JOYSTICK_DESCRIPTOR(GamepadConfig, gamepadDescriptor);
+Joystick<GamepadConfig> joystick(gamepadDescriptor);
 
-SBusTracker xAxisTracker;
-SBusTracker yAxisTracker;
-SBusTracker rxTracker;
-SBusTracker ryTracker;
-SBusTracker lTriSwitchTracker;
-SBusTracker rTriSwitchTracker;
-SBusTracker lButTracker;
-SBusTracker rButTracker;
-SBusTracker SEButTracker;
+FUTABA_SBUS sBus;
+Failsafe failsafe;
+FrameRate frameRate;
+
+// The axis moving average is only kept while some axis is AXIS_AVERAGED
+TrackerIf<axis_smoothing_used(AXIS_AVERAGED), AXIS_SLOTS, TRACKER_CAPACITY(AXIS_WINDOW_MS)>::Type axisTracker(axisChannels, AXIS_WINDOW_MS);
+MultiChannelTracker<SWITCH_SLOTS, TRACKER_CAPACITY(SWITCH_WINDOW_MS), uint8_t, uint16_t, SWITCH_SAMPLE_SHIFT> switchTracker(SwitchFilters::channels, SWITCH_WINDOW_MS);
+SpikeFilter<SPIKE_SLOTS> spikeFilter(spikeTable.channels, spikeTable.slew);
+Calibration calibration;
+SwitchFilters switchFilters;
+AxisFilter axisFilters[AXIS_SLOTS];
+AxisPredictor axisPredictors[AXIS_SLOTS];
+
+// Window lengths and the majority threshold for a new frame period
+void retime_trackers(uint16_t period_us) {
+  axisTracker.retime(period_us);
+  switchTracker.retime(period_us);
+  majorityThreshold = majority_threshold(switchTracker.get_length());
+}
 
 void setup() {
 
@@ -320,75 +283,245 @@ void setup() {
   pinMode(8, OUTPUT);
   // Initialize Serial only when debug logging is enabled
   DEBUG_BEGIN(115200);
+  FRAME_CYCLES_SETUP();
   // Configure JoyStick
-  Joystick.setXAxisRange(MIN_SIGNAL, MAX_SIGNAL);
-  Joystick.setYAxisRange(MIN_SIGNAL, MAX_SIGNAL);
-  Joystick.setRxAxisRange(MIN_SIGNAL, MAX_SIGNAL);
-  Joystick.setRyAxisRange(MIN_SIGNAL, MAX_SIGNAL);
-  Joystick.setThrottleRange(MIN_SIGNAL, MAX_SIGNAL);
-  Joystick.setRudderRange(MIN_SIGNAL, MAX_SIGNAL);
+  joystick.setXAxisRange(SIGNAL_LOW, SIGNAL_HIGH);
+  joystick.setYAxisRange(SIGNAL_LOW, SIGNAL_HIGH);
+  joystick.setRxAxisRange(SIGNAL_LOW, SIGNAL_HIGH);
+  joystick.setRyAxisRange(SIGNAL_LOW, SIGNAL_HIGH);
+  joystick.setThrottleRange(SIGNAL_LOW, SIGNAL_HIGH);
+  joystick.setRudderRange(SIGNAL_LOW, SIGNAL_HIGH);
+  // Never wait on USB: a report the host has not picked up yet is replaced
+  // by the next one, so a slow or suspended host cannot stall FeedLine()
+  joystick.setNonBlockingSend(true);
   
   // Begin!!!
-  Joystick.begin();
+  joystick.begin();
   sBus.begin();
+  if (!calibration.begin()) {
+    DEBUG_PRINTLN("No stored calibration, using default channel ranges");
+  }
+  retime_trackers(frameRate.period_us());
+}
+
+// Calibrated, spike-filtered channels of the current frame, indexed by frame
+// channel. Kept apart from sBus.channels, which holds raw values and keeps
+// them for channels a subset frame did not carry.
+static int16_t calibratedChannels[CALIBRATION_CHANNELS];
+
+void update_trackers(const int16_t *values) {
+  axisTracker.add(values);
+  switchTracker.add(values);
 }
 
-void update_trackers(FUTABA_SBUS & sBus) {
-  xAxisTracker.add(sBus.channels[XAXIS_CHANNEL]);
-  yAxisTracker.add(sBus.channels[YAXIS_CHANNEL]);
-  rxTracker.add(sBus.channels[RX_CHANNEL]);
-  ryTracker.add(sBus.channels[RY_CHANNEL]);
-  lTriSwitchTracker.add(sBus.channels[L_TRI_SWITCH_CHANNEL]);
-  rTriSwitchTracker.add(sBus.channels[R_TRI_SWITCH_CHANNEL]);
-  lButTracker.add(sBus.channels[LBUTTON_CHANNEL]);
-  rButTracker.add(sBus.channels[RBUTTON_CHANNEL]);
-  SEButTracker.add(sBus.channels[SE_BUTTON_CHANNEL]);
+// lead_q8: how long ago, in frames (Q8), the current frame started arriving
+static long axis_value(AxisSlot slot, uint16_t lead_q8) {
+  switch (axisSmoothing[slot]) {
+    case AXIS_ADAPTIVE:
+      return axisFilters[slot].process(calibratedChannels[axisChannels[slot]]);
+    case AXIS_PREDICTED:
+      axisPredictors[slot].update(calibratedChannels[axisChannels[slot]]);
+      return axisPredictors[slot].predict(lead_q8);
+    default:
+      return axisTracker.get_estimated(slot);
+  }
+}
+
+// Filter every switch slot's tracker estimate into values, in SwitchSlot
+// order, then step all the switch decoders over them in one pass
+static void decode_switches(long *values) {
+  for (uint8_t slot = 0; slot < SWITCH_SLOTS; slot++) {
+    values[slot] = switchTracker.get_estimated(slot);
+  }
+  uint16_t changed = switchFilters.process(values);
+#if defined(DEBUG_LOG)
+  for (uint8_t slot = 0; slot < SWITCH_SLOTS; slot++) {
+    if (changed & (1u << slot)) {
+      DEBUG_PRINT("Switch "); DEBUG_PRINT(slot); DEBUG_PRINT(" -> ");
+      DEBUG_PRINT(positionToString(SwitchFilters::profiles[slot], switchFilters.position(slot)));
+      DEBUG_PRINT(" | raw="); DEBUG_PRINTLN(values[slot]);
+    }
+  }
+#else
+  (void)changed;
+#endif
 }
 
 static int modeIndex = -1;
 static int lastModeIndex = -1;
+static uint16_t linkStatisticsSeen = 0;
+
+// Drive all axes to their failsafe values and release every button in one report
+void send_neutral() {
+  joystick.beginTransaction();
+  joystick.setXAxis(FAILSAFE_XAXIS);
+  joystick.setYAxis(FAILSAFE_YAXIS);
+  joystick.setRxAxis(FAILSAFE_RXAXIS);
+  joystick.setRyAxis(FAILSAFE_RYAXIS);
+  joystick.setThrottle(FAILSAFE_THROTTLE);
+  joystick.setRudder(FAILSAFE_RUDDER);
+  for (uint8_t button = 0; button < 11; button++) {
+    joystick.setButton(button, OFF);
+  }
+  joystick.commitTransaction();
+  digitalWrite(8, LOW);
+}
+
+// Start from released buttons and settled filters on the next frame
+void reset_filters() {
+  switchFilters.reset();
+  for (uint8_t slot = 0; slot < AXIS_SLOTS; slot++) {
+    axisFilters[slot] = AxisFilter();
+    axisPredictors[slot] = AxisPredictor();
+  }
+  lastModeIndex = -1;
+  spikeFilter.reset();
+}
+
+void apply_failsafe() {
+  send_neutral();
+  reset_filters();
+  frameRate.restart();
+  DEBUG_PRINTLN("Failsafe: link lost, outputs neutral");
+}
+
+static unsigned long gestureStart = 0;
+static bool gestureHeld = false;
+static bool gestureFired = false;
+// L, R and SE are kept from the host from the moment all three are held
+// until all three are released, so the gesture never triggers their actions
+static bool gestureMuted = false;
+
+// True once per CALIBRATION_HOLD_MS hold of the L, R and SE buttons, on raw channels
+static bool calibration_gesture(unsigned long now_ms) {
+  constexpr static int pressed = signal_above(0.5);
+  uint8_t count = (sBus.channels[LBUTTON_CHANNEL] > pressed)
+                + (sBus.channels[RBUTTON_CHANNEL] > pressed)
+                + (sBus.channels[SE_BUTTON_CHANNEL] > pressed);
+  bool held = count == 3;
+  if (held) {
+    gestureMuted = true;
+  } else if (count == 0) {
+    gestureMuted = false;
+  }
+  if (!held) {
+    gestureHeld = false;
+    gestureFired = false;
+    return false;
+  }
+  if (!gestureHeld) {
+    gestureHeld = true;
+    gestureStart = now_ms;
+  }
+  if (gestureFired || now_ms - gestureStart < CALIBRATION_HOLD_MS) {
+    return false;
+  }
+  gestureFired = true;
+  return true;
+}
+
+// Calibration mode: outputs stay neutral and the LED blinks while every used
+// channel is swept to its ends; release the sticks before saving
+static void run_calibration(unsigned long now_ms) {
+  if (calibration_gesture(now_ms)) {
+    if (calibration.is_calibrating()) {
+      uint8_t calibrated = calibration.finish(sBus.channels, USED_CHANNELS_MASK);
+      reset_filters();
+      // No frame was timed while calibrating, don't take that gap as an interval
+      frameRate.restart();
+      DEBUG_PRINT("Calibration saved, channels: "); DEBUG_PRINTLN(calibrated);
+      (void)calibrated;
+    } else if (!calibration.is_saving()) {
+      send_neutral();
+      calibration.start();
+      DEBUG_PRINTLN("Calibration: move every stick and switch to its ends");
+    }
+    return;
+  }
+  if (calibration.is_calibrating()) {
+    calibration.learn(sBus.channels, USED_CHANNELS_MASK);
+    digitalWrite(8, (now_ms >> 7) & 1 ? HIGH : LOW);
+  }
+}
+
+// Frames received since the last reports-per-frame check
+static unsigned int statsFrameCount = 0;
+static uint32_t statsReportBase = 0;
+#if defined(FRAME_CYCLES)
+static uint32_t frameCycles = 0;
+#endif
 void loop() {
   sBus.FeedLine();
+  // Send a report left waiting by a busy endpoint, or the keepalive resend
+  // of an unchanged report if the host asked for one
+  joystick.poll();
+  // At most one byte of a finished calibration goes to EEPROM per pass
+  calibration.save();
+
+  // Failsafe runs every pass, frame or not, to bound the time to neutral
+  unsigned long now = micros();
+  if (sBus.linkStatisticsCount != linkStatisticsSeen) {
+    linkStatisticsSeen = sBus.linkStatisticsCount;
+    failsafe.set_link_quality(sBus.linkStatistics.uplinkLinkQuality);
+  }
+  if (sBus.toChannels == 1) {
+    failsafe.frame_received(now);
+  }
+  if (failsafe.update(now)) {
+    if (failsafe.entered()) {
+      apply_failsafe();
+    }
+    sBus.toChannels = 0;
+    return;
+  }
+
   if (sBus.toChannels == 1){
-    sBus.UpdateChannels();
+    sBus.UpdateChannels<USED_CHANNELS_MASK>();
     sBus.toChannels = 0; 
 
-    update_trackers(sBus);
-
-    Joystick.setXAxis(xAxisTracker.get_estimated());
-    Joystick.setYAxis(yAxisTracker.get_estimated());
-    Joystick.setRxAxis(rxTracker.get_estimated());
-    Joystick.setRyAxis(ryTracker.get_estimated());
-    Joystick.setThrottle(lTriSwitchTracker.get_estimated());
-    Joystick.setRudder(rTriSwitchTracker.get_estimated());
-    // Use normalized enter/exit hysteresis + debounce for buttons (same mech as tri-switch)
-    update_button_hysteresis(Map, lButTracker.get_estimated(), l_button_state, l_button_mode_counter, l_button_exit_counter, "LBtn");
-    update_button_hysteresis(Map, rButTracker.get_estimated(), r_button_state, r_button_mode_counter, r_button_exit_counter, "RBtn");
-    Joystick.setButton(0, l_button_state);
-    Joystick.setButton(1, r_button_state);
-
-    // Apply the exponential moving average filter
-    long l_est = ema_update(l_est_ema, l_est_ema_init, EMA_ALPHA, lTriSwitchTracker.get_estimated());
-    long r_est = ema_update(r_est_ema, r_est_ema_init, EMA_ALPHA, rTriSwitchTracker.get_estimated());
-    int se_est = static_cast<int>(ema_update(se_est_ema, se_est_ema_init, EMA_ALPHA, SEButTracker.get_estimated()));
-
-    // Median-of-3 prefilter for L and R raw estimates
-    l_raw_buf[l_raw_idx] = l_est;
-    l_raw_idx = (l_raw_idx + 1) % 3;
-    long l_med_vals[3] = { l_raw_buf[0], l_raw_buf[1], l_raw_buf[2] };
-    // sort 3 values to get median
-    for (int i = 0; i < 2; ++i) for (int j = i+1; j < 3; ++j) if (l_med_vals[i] > l_med_vals[j]) { long t = l_med_vals[i]; l_med_vals[i] = l_med_vals[j]; l_med_vals[j] = t; }
-    long l_med = l_med_vals[1];
-
-    r_raw_buf[r_raw_idx] = r_est;
-    r_raw_idx = (r_raw_idx + 1) % 3;
-    long r_med_vals[3] = { r_raw_buf[0], r_raw_buf[1], r_raw_buf[2] };
-    for (int i = 0; i < 2; ++i) for (int j = i+1; j < 3; ++j) if (r_med_vals[i] > r_med_vals[j]) { long t = r_med_vals[i]; r_med_vals[i] = r_med_vals[j]; r_med_vals[j] = t; }
-    long r_med = r_med_vals[1];
+    run_calibration(millis());
+    if (calibration.is_calibrating()) {
+      return;
+    }
+    FRAME_CYCLES_BEGIN();
+    // Map each channel's learned range onto the standard one the thresholds expect
+    calibration.apply(sBus.channels, calibratedChannels, USED_CHANNELS_MASK);
+
+    if (frameRate.frame(sBus.frameTimestamp)) {
+      switchFilters.retime(frameRate.period_us());
+      spikeFilter.retime(frameRate.period_us());
+      retime_trackers(frameRate.period_us());
+      DEBUG_PRINT("Frame rate: "); DEBUG_PRINT(frameRate.rate_hz()); DEBUG_PRINTLN(" Hz");
+    }
+
+    // Drop impossible jumps before anything averages them in
+    spikeFilter.filter(calibratedChannels);
+    update_trackers(calibratedChannels);
+
+    // Stage every axis/button change of this frame and send them as one report
+    joystick.beginTransaction();
+
+    // The report goes out at the end of this pass; predicted axes lead by the frame's age
+    uint16_t lead_q8 = frameRate.frames_q8((uint16_t)micros() - sBus.frameTimestamp);
+    // then deadband/expo/rate from the flash tables (identity unless tools/gen_response_curves.py is edited)
+    joystick.setXAxis(response_curve(&responseCurveX, axis_value(X_SLOT, lead_q8)));
+    joystick.setYAxis(response_curve(&responseCurveY, axis_value(Y_SLOT, lead_q8)));
+    joystick.setRxAxis(response_curve(&responseCurveRx, axis_value(RX_SLOT, lead_q8)));
+    joystick.setRyAxis(response_curve(&responseCurveRy, axis_value(RY_SLOT, lead_q8)));
+    joystick.setThrottle(switchTracker.get_estimated(L_TRI_SLOT));
+    joystick.setRudder(switchTracker.get_estimated(R_TRI_SLOT));
+    // EMA and median-of-3 for the tri-switches, then enter/exit hysteresis and
+    // debounce for the tri-switches and buttons alike. The decoders keep
+    // running while the calibration gesture mutes the buttons.
+    long switchValues[SWITCH_SLOTS];
+    decode_switches(switchValues);
+    joystick.setButton(0, gestureMuted ? OFF : switchFilters.position(L_BUT_SLOT));
+    joystick.setButton(1, gestureMuted ? OFF : switchFilters.position(R_BUT_SLOT));
 
     // Combine the two switch modes (L_TRI_SWITCH and R_TRI_SWITCH) into a single index (0-8)
-    TriSwitchMode lMode = getTriSwitchModeWithHysteresis(Map, l_med, lastLMode, "L");
-    TriSwitchMode rMode = getTriSwitchModeWithHysteresis(Map, r_med, lastRMode, "R");
+    TriSwitchMode lMode = static_cast<TriSwitchMode>(switchFilters.position(L_TRI_SLOT));
+    TriSwitchMode rMode = static_cast<TriSwitchMode>(switchFilters.position(R_TRI_SLOT));
+    int se_est = static_cast<int>(switchValues[SE_BUT_SLOT]);
 
     modeIndex = (static_cast<int>(lMode) * 3) + static_cast<int>(rMode);
 
@@ -397,12 +530,12 @@ void loop() {
     // R: DOWN, MID, UP = 0, 1, 2
     // modeIndex = L * 3 + R
     if (modeIndex >= 0 && modeIndex <= 8) {
-      Joystick.setButton(modeIndex + 2, Map.get_button_state(se_est));
+      joystick.setButton(modeIndex + 2, gestureMuted ? OFF : Map.get_button_state(se_est));
     }
 
     // Only update if modeIndex has changed
     if (modeIndex != lastModeIndex) {
-      if (lastModeIndex >= 0 && lastModeIndex <= 8) Joystick.setButton(lastModeIndex + 2, OFF);
+      if (lastModeIndex >= 0 && lastModeIndex <= 8) joystick.setButton(lastModeIndex + 2, OFF);
       lastModeIndex = modeIndex;
 #if defined(DEBUG_LOG)
       DEBUG_PRINT("Mode Index: "); DEBUG_PRINTLN(modeIndex);
@@ -410,8 +543,33 @@ void loop() {
 #endif
     }
     
-    if (lButTracker.get_estimated() > MAJORITY_THRESH || 
-        rButTracker.get_estimated() > MAJORITY_THRESH)
+    joystick.commitTransaction();
+    FRAME_CYCLES_END();
+
+    // Every REPORT_STATS_INTERVAL frames check that each frame produced at most one report
+    if (++statsFrameCount >= REPORT_STATS_INTERVAL) {
+#if defined(DEBUG_LOG)
+      uint32_t reports = joystick.getSentReportCount() - statsReportBase;
+      DEBUG_PRINT("Reports/frame: "); DEBUG_PRINT(reports); DEBUG_PRINT("/"); DEBUG_PRINT(statsFrameCount);
+      DEBUG_PRINT(" suppressed: "); DEBUG_PRINT(joystick.getSuppressedReportCount());
+      DEBUG_PRINT(" overwritten: "); DEBUG_PRINT(joystick.getOverwrittenReportCount());
+      DEBUG_PRINT(" endpoint busy: "); DEBUG_PRINTLN(joystick.getEndpointBusyCount());
+#if defined(FRAME_CYCLES)
+      DEBUG_PRINT("Cycles/frame: "); DEBUG_PRINTLN(frameCycles / statsFrameCount);
+      frameCycles = 0;
+#endif
+      DEBUG_PRINT("Spike rejects:");
+      for (uint8_t slot = 0; slot < SPIKE_SLOTS; slot++) {
+        DEBUG_PRINT(" "); DEBUG_PRINT(spikeFilter.get_rejects(slot));
+      }
+      DEBUG_PRINTLN("");
+#endif
+      statsReportBase = joystick.getSentReportCount();
+      statsFrameCount = 0;
+    }
+    
+    if (switchTracker.get_estimated(L_BUT_SLOT) > majorityThreshold ||
+        switchTracker.get_estimated(R_BUT_SLOT) > majorityThreshold)
     {
       digitalWrite(8, HIGH);
     }
@@ -0,0 +1,59 @@
+// AlphaBetaPredictor.h
+#ifndef ALPHA_BETA_PREDICTOR_H
+#define ALPHA_BETA_PREDICTOR_H
+
+#include <Arduino.h>
+#include "SBusTracker.h"
+
+#define PREDICT_VELOCITY_MAX 512 // counts/frame, about a full stick sweep in 3 frames
+#define PREDICT_LEAD_MAX_Q8 256  // never extrapolate more than one frame ahead
+
+// Constant-velocity (alpha-beta) tracker for one axis, used to extrapolate
+// the last sample to the moment the report goes out. Position is kept in Q8
+// counts and velocity in Q8 counts/frame, so the filter itself does not care
+// about the packet rate; only the lead passed to predict() does.
+//   predicted = x + v
+//   x = predicted + AlphaQ8 * residual
+//   v = v + BetaQ8 * residual
+// Velocity, lead and output are clamped so a glitch cannot fling the axis.
+template <int32_t AlphaQ8, int32_t BetaQ8>
+class AlphaBetaPredictor {
+    private:
+        // Stable for 0 < alpha <= 1 and 0 < beta < 4 - 2 * alpha, in Q8
+        static_assert(AlphaQ8 > 0 && AlphaQ8 <= 256, "alpha must be in (0, 256]");
+        static_assert(BetaQ8 > 0 && BetaQ8 < 1024 - 2 * AlphaQ8, "beta must be in (0, 1024 - 2 * alpha)");
+
+        int32_t position = 0;
+        int32_t velocity = 0;
+        bool inited = false;
+
+    public:
+        // Once per received frame
+        void update(long sample) {
+            int32_t measured = static_cast<int32_t>(sample) << 8;
+            if (!inited) {
+                position = measured;
+                velocity = 0;
+                inited = true;
+                return;
+            }
+            int32_t predicted = position + velocity;
+            int32_t residual = measured - predicted;
+            position = predicted + ((AlphaQ8 * residual) >> 8);
+            velocity += (BetaQ8 * residual) >> 8;
+            if (velocity > ((int32_t)PREDICT_VELOCITY_MAX << 8)) velocity = (int32_t)PREDICT_VELOCITY_MAX << 8;
+            if (velocity < -((int32_t)PREDICT_VELOCITY_MAX << 8)) velocity = -((int32_t)PREDICT_VELOCITY_MAX << 8);
+        }
+
+        // Estimate lead_q8 frames (Q8) after the last sample
+        long predict(uint16_t lead_q8) {
+            if (lead_q8 > PREDICT_LEAD_MAX_Q8) lead_q8 = PREDICT_LEAD_MAX_Q8;
+            int32_t estimate = position + ((velocity * (int32_t)lead_q8) >> 8);
+            long counts = (estimate + 128) >> 8;
+            if (counts < 0) return 0;
+            if (counts > SBUS_TRACKER_SAMPLE_MAX) return SBUS_TRACKER_SAMPLE_MAX;
+            return counts;
+        }
+};
+
+#endif
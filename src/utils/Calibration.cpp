@@ -0,0 +1,172 @@
+#include "Calibration.h"
+#include <stddef.h>
+#include <EEPROM.h>
+#include <avr/eeprom.h>
+#include <CRSF_CRC8.h>
+
+
+Calibration::Calibration() {
+    save_offset = sizeof(CalibrationRecord);
+    calibrating = false;
+    seeded = false;
+    for (uint8_t c = 0; c < CALIBRATION_CHANNELS; c++) {
+        center_in[c] = CALIBRATION_OUT_CENTER;
+        scale_neg[c] = 1 << CALIBRATION_SCALE_SHIFT;
+        scale_pos[c] = 1 << CALIBRATION_SCALE_SHIFT;
+    }
+}
+
+uint8_t Calibration::checksum(const CalibrationRecord &record) {
+    const uint8_t *bytes = reinterpret_cast<const uint8_t *>(&record);
+    uint8_t crc = 0;
+    for (uint8_t i = 0; i < offsetof(CalibrationRecord, checksum); i++) {
+        crc = crsf_crc8_update(crc, bytes[i]);
+    }
+    return crc;
+}
+
+bool Calibration::valid(const ChannelCalibration &channel) {
+    return channel.center - channel.min >= CALIBRATION_SPAN_MIN
+        && channel.max - channel.center >= CALIBRATION_SPAN_MIN;
+}
+
+bool Calibration::load(CalibrationRecord &record) {
+    EEPROM.get(CALIBRATION_EEPROM_ADDRESS, record);
+    if (record.magic == CALIBRATION_MAGIC && record.version == CALIBRATION_VERSION
+        && record.checksum == checksum(record)) {
+        return true;
+    }
+    for (uint8_t c = 0; c < CALIBRATION_CHANNELS; c++) {
+        record.channels[c].min = 0;
+        record.channels[c].center = 0;
+        record.channels[c].max = 0;
+    }
+    return false;
+}
+
+void Calibration::precompute(const CalibrationRecord &record) {
+    for (uint8_t c = 0; c < CALIBRATION_CHANNELS; c++) {
+        const ChannelCalibration &channel = record.channels[c];
+        if (!valid(channel)) {
+            // Identity: the standard center with unit scale
+            center_in[c] = CALIBRATION_OUT_CENTER;
+            scale_neg[c] = 1 << CALIBRATION_SCALE_SHIFT;
+            scale_pos[c] = 1 << CALIBRATION_SCALE_SHIFT;
+            continue;
+        }
+        int16_t below = channel.center - channel.min;
+        int16_t above = channel.max - channel.center;
+        center_in[c] = channel.center;
+        scale_neg[c] = (((int32_t)(CALIBRATION_OUT_CENTER - CALIBRATION_OUT_LOW) << CALIBRATION_SCALE_SHIFT) + below / 2) / below;
+        scale_pos[c] = (((int32_t)(CALIBRATION_OUT_HIGH - CALIBRATION_OUT_CENTER) << CALIBRATION_SCALE_SHIFT) + above / 2) / above;
+    }
+}
+
+bool Calibration::begin() {
+    CalibrationRecord record;
+    bool found = load(record);
+    precompute(record);
+    return found;
+}
+
+void Calibration::start() {
+    if (is_saving()) {
+        return;
+    }
+    calibrating = true;
+    seeded = false;
+}
+
+void Calibration::learn(const int16_t *values, uint16_t mask) {
+    if (!calibrating) {
+        return;
+    }
+    for (uint8_t c = 0; c < CALIBRATION_CHANNELS; c++) {
+        if (!(mask & (1u << c))) {
+            continue;
+        }
+        ChannelCalibration &learned = pending.channels[c];
+        if (!seeded) {
+            // The first frame seeds the endpoints
+            learned.min = values[c];
+            learned.max = values[c];
+        } else if (values[c] < learned.min) {
+            learned.min = values[c];
+        } else if (values[c] > learned.max) {
+            learned.max = values[c];
+        }
+    }
+    seeded = true;
+}
+
+uint8_t Calibration::finish(const int16_t *values, uint16_t mask) {
+    if (!calibrating) {
+        return 0;
+    }
+    calibrating = false;
+    if (!seeded) {
+        return 0;
+    }
+
+    CalibrationRecord record;
+    load(record);
+    uint8_t calibrated = 0;
+    for (uint8_t c = 0; c < CALIBRATION_CHANNELS; c++) {
+        if (!(mask & (1u << c))) {
+            continue;
+        }
+        ChannelCalibration learned = pending.channels[c];
+        // Sticks rest inside their travel, take the center from this frame.
+        // A channel parked near an end (a button or two-position switch) has
+        // no center of its own, use the middle of its travel.
+        int16_t margin = (learned.max - learned.min) / 10;
+        if (values[c] > learned.min + margin && values[c] < learned.max - margin) {
+            learned.center = values[c];
+        } else {
+            learned.center = learned.min + (learned.max - learned.min) / 2;
+        }
+        if (valid(learned)) {
+            record.channels[c] = learned;
+            calibrated++;
+        }
+    }
+
+    record.magic = CALIBRATION_MAGIC;
+    record.version = CALIBRATION_VERSION;
+    record.checksum = checksum(record);
+    pending = record;
+    save_offset = 0;
+    precompute(pending);
+    return calibrated;
+}
+
+bool Calibration::save() {
+    if (!is_saving()) {
+        return false;
+    }
+    if (!eeprom_is_ready()) {
+        return true;
+    }
+    const uint8_t *bytes = reinterpret_cast<const uint8_t *>(&pending);
+    // Reads are quick; skip the bytes that already match
+    while (save_offset < sizeof(CalibrationRecord)) {
+        uint8_t offset = save_offset++;
+        if (EEPROM.read(CALIBRATION_EEPROM_ADDRESS + offset) != bytes[offset]) {
+            EEPROM.write(CALIBRATION_EEPROM_ADDRESS + offset, bytes[offset]);
+            break;
+        }
+    }
+    return is_saving();
+}
+
+void Calibration::apply(const int16_t *raw, int16_t *out, uint16_t mask) {
+    for (uint8_t c = 0; c < CALIBRATION_CHANNELS; c++) {
+        if (!(mask & (1u << c))) {
+            continue;
+        }
+        int32_t offset = raw[c] - center_in[c];
+        int32_t scaled = (offset * (offset < 0 ? scale_neg[c] : scale_pos[c])) >> CALIBRATION_SCALE_SHIFT;
+        int32_t value = CALIBRATION_OUT_CENTER + scaled;
+        out[c] = value < 0 ? 0 : (value > 2047 ? 2047 : value);
+    }
+}
@@ -0,0 +1,95 @@
+// Calibration.h
+#ifndef CALIBRATION_H
+#define CALIBRATION_H
+
+#include <Arduino.h>
+
+#define CALIBRATION_CHANNELS 16
+#define CALIBRATION_EEPROM_ADDRESS 0
+#define CALIBRATION_MAGIC 0x4C43 // "CL"
+#define CALIBRATION_VERSION 1
+#define CALIBRATION_SPAN_MIN 200 // counts each side of center for a channel to count as calibrated
+#define CALIBRATION_SCALE_SHIFT 12
+
+// Standard range calibrated channels are mapped onto, so everything after
+// apply() keeps its thresholds (CRSF +-100%)
+#define CALIBRATION_OUT_LOW 172
+#define CALIBRATION_OUT_CENTER 992
+#define CALIBRATION_OUT_HIGH 1811
+
+struct ChannelCalibration {
+    int16_t min;
+    int16_t center;
+    int16_t max;
+};
+
+// Layout in EEPROM, checksummed with the CRSF CRC8 over everything before it
+struct CalibrationRecord {
+    uint16_t magic;
+    uint8_t version;
+    ChannelCalibration channels[CALIBRATION_CHANNELS];
+    uint8_t checksum;
+};
+
+// Per-channel endpoint and center calibration.
+// begin() loads the record from EEPROM and precomputes, per channel, a Q12
+// scale for each side of center, so apply() costs one multiply and one shift
+// per channel. Channels without a valid calibration pass through unchanged.
+// Calibration mode: start(), then learn() on every frame while the sticks and
+// switches are swept to their ends, then finish() with the sticks released.
+// finish() only queues the record: save(), called on every loop pass, writes
+// it one changed byte at a time while the EEPROM is idle, so the ~3.4 ms each
+// byte takes never blocks the loop. The checksum is the last byte written.
+class Calibration {
+    private:
+        int16_t center_in[CALIBRATION_CHANNELS];
+        int16_t scale_neg[CALIBRATION_CHANNELS];
+        int16_t scale_pos[CALIBRATION_CHANNELS];
+        // Endpoints while calibrating, then the record being saved
+        CalibrationRecord pending;
+        uint8_t save_offset; // next record byte to save, sizeof(CalibrationRecord) when idle
+        bool calibrating;
+        bool seeded;
+
+        static uint8_t checksum(const CalibrationRecord &record);
+        static bool valid(const ChannelCalibration &channel);
+        // Reads the stored record, false (and an all-invalid record) if there is none
+        static bool load(CalibrationRecord &record);
+        void precompute(const CalibrationRecord &record);
+
+    public:
+        Calibration();
+
+        // Load and check the stored calibration; returns false if there is none
+        bool begin();
+
+        // Ignored while the previous calibration is still being saved
+        void start();
+
+        // Widen the learned endpoints with one frame (raw values, indexed by frame channel)
+        void learn(const int16_t *values, uint16_t mask);
+
+        // Take centers from this frame, switch to the new scales and queue
+        // them for save(). Channels that were not moved far enough keep their
+        // old calibration. Returns the number of channels calibrated.
+        uint8_t finish(const int16_t *values, uint16_t mask);
+
+        // Write the next changed byte of a queued record if the EEPROM is
+        // idle; returns true while the save is still in progress
+        bool save();
+
+        bool is_calibrating() {
+            return calibrating;
+        }
+
+        bool is_saving() {
+            return save_offset < sizeof(CalibrationRecord);
+        }
+
+        // Map the channels in mask from raw onto the standard range in out.
+        // Both are indexed by frame channel; out must not be the raw array,
+        // which keeps the decoder's values for channels a frame did not carry.
+        void apply(const int16_t *raw, int16_t *out, uint16_t mask);
+};
+
+#endif
@@ -0,0 +1,44 @@
+#include "Failsafe.h"
+
+
+Failsafe::Failsafe(unsigned long timeout_ms) {
+    timeout_us = timeout_ms * 1000UL;
+    last_frame_us = 0;
+    frame_seen = false;
+    link_up = true;
+    active = true;
+    just_entered = true;
+}
+
+void Failsafe::frame_received(unsigned long now_us) {
+    last_frame_us = now_us;
+    frame_seen = true;
+}
+
+void Failsafe::set_link_quality(uint8_t link_quality) {
+    link_up = link_quality > 0;
+}
+
+bool Failsafe::update(unsigned long now_us) {
+    if (frame_seen && (now_us - last_frame_us) > timeout_us) {
+        // Require a fresh frame to recover, so micros() wrapping cannot
+        // make a long-dead link look alive again
+        frame_seen = false;
+    }
+    bool lost = !frame_seen || !link_up;
+    if (lost && !active) {
+        just_entered = true;
+    }
+    active = lost;
+    return active;
+}
+
+bool Failsafe::is_active() {
+    return active;
+}
+
+bool Failsafe::entered() {
+    bool result = just_entered;
+    just_entered = false;
+    return result;
+}
@@ -0,0 +1,41 @@
+// Failsafe.h
+#ifndef FAILSAFE_H
+#define FAILSAFE_H
+
+#include <Arduino.h>
+
+#define FAILSAFE_TIMEOUT_MS 100 // no RC frame for this long means the link is gone
+
+// Link-loss detector. A micros()-based watchdog is kicked by every RC frame;
+// CRSF link statistics reporting zero uplink quality also count as loss.
+// update() must be called every loop(), not only when a frame arrives, so the
+// outputs reach neutral within FAILSAFE_TIMEOUT_MS plus one loop() pass.
+// The detector starts out in failsafe until the first frame is received.
+class Failsafe {
+    private:
+        unsigned long timeout_us;
+        unsigned long last_frame_us;
+        bool frame_seen;
+        bool link_up;
+        bool active;
+        bool just_entered;
+
+    public:
+        Failsafe(unsigned long timeout_ms);
+
+        Failsafe() : Failsafe(FAILSAFE_TIMEOUT_MS) {};
+
+        void frame_received(unsigned long now_us);
+
+        void set_link_quality(uint8_t link_quality);
+
+        // Returns true while failsafe is active
+        bool update(unsigned long now_us);
+
+        bool is_active();
+
+        // True once, on the update() that entered failsafe
+        bool entered();
+};
+
+#endif
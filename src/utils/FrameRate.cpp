@@ -0,0 +1,51 @@
+#include "FrameRate.h"
+
+
+FrameRate::FrameRate() {
+    last_stamp = 0;
+    stamp_seen = false;
+    measured = false;
+    long_intervals = 0;
+    period_q4 = (uint32_t)FRAME_PERIOD_DEFAULT_US << 4;
+    published_us = FRAME_PERIOD_DEFAULT_US;
+}
+
+bool FrameRate::frame(uint16_t stamp_us) {
+    uint16_t interval = stamp_us - last_stamp;
+    bool valid = stamp_seen && interval >= FRAME_PERIOD_MIN_US && interval <= FRAME_PERIOD_MAX_US;
+    last_stamp = stamp_us;
+    stamp_seen = true;
+    if (!valid) {
+        return false;
+    }
+
+    uint32_t sample = (uint32_t)interval << 4;
+    if (measured && sample * 2 > period_q4 * 3) {
+        // Spans a lost frame, unless they keep coming
+        if (++long_intervals < FRAME_PERIOD_GAP_RUN) {
+            return false;
+        }
+        measured = false;
+    }
+    long_intervals = 0;
+    if (!measured) {
+        // Start from the first real interval rather than crawling from the default
+        period_q4 = sample;
+        measured = true;
+    } else {
+        period_q4 = period_q4 - (period_q4 >> 3) + (sample >> 3);
+    }
+
+    uint16_t period = (period_q4 + 8) >> 4;
+    uint16_t drift = period > published_us ? period - published_us : published_us - period;
+    if (drift <= (published_us >> FRAME_PERIOD_RETUNE_SHIFT)) {
+        return false;
+    }
+    published_us = period;
+    return true;
+}
+
+void FrameRate::restart() {
+    stamp_seen = false;
+    long_intervals = 0;
+}
@@ -0,0 +1,56 @@
+// FrameRate.h
+#ifndef FRAME_RATE_H
+#define FRAME_RATE_H
+
+#include <Arduino.h>
+
+#define FRAME_PERIOD_DEFAULT_US 4000 // 250 Hz, the rate the filter constants were first tuned at
+#define FRAME_PERIOD_MIN_US 1000     // 1 kHz
+#define FRAME_PERIOD_MAX_US 50000    // 20 Hz; longer gaps are dropouts, not a packet rate
+#define FRAME_PERIOD_RETUNE_SHIFT 4  // publish a new period once it drifts by more than 1/16
+#define FRAME_PERIOD_GAP_RUN 8       // long intervals in a row that mean the rate really dropped
+
+// Measures the incoming frame period from the frame timestamps (micros() & 0xFFFF)
+// so filter constants can be given in milliseconds. The measured period is
+// smoothed and only published when it moves by more than 1/16, so the
+// per-frame coefficients derived from it are recomputed on a packet-rate
+// change rather than on every bit of jitter.
+//
+// Only good frames are timed, so a frame lost to a CRC failure or a dropout
+// leaves an interval two or more periods long. Intervals over 1.5 times the
+// estimate are skipped for that reason; FRAME_PERIOD_GAP_RUN of them in a row
+// are a slower packet rate, which is then measured afresh.
+class FrameRate {
+    private:
+        uint16_t last_stamp;
+        bool stamp_seen;
+        bool measured;
+        uint8_t long_intervals; // skipped long intervals in a row
+        uint32_t period_q4; // smoothed period, Q4 microseconds
+        uint16_t published_us;
+
+    public:
+        FrameRate();
+
+        // Feed one frame timestamp. Returns true when period_us() changed.
+        bool frame(uint16_t stamp_us);
+
+        // Forget the last timestamp, e.g. after a link dropout
+        void restart();
+
+        uint16_t period_us() {
+            return published_us;
+        }
+
+        // elapsed_us in frames, Q8
+        uint16_t frames_q8(uint16_t elapsed_us) {
+            uint32_t frames = ((uint32_t)elapsed_us << 8) / published_us;
+            return frames > 0xFFFF ? 0xFFFF : (uint16_t)frames;
+        }
+
+        uint16_t rate_hz() {
+            return (1000000UL + published_us / 2) / published_us;
+        }
+};
+
+#endif
@@ -0,0 +1,179 @@
+// MultiChannelTracker.h
+#ifndef MULTI_CHANNEL_TRACKER_H
+#define MULTI_CHANNEL_TRACKER_H
+
+#include <Arduino.h>
+#include "SBusTracker.h"
+#include "FrameRate.h"
+
+// Builds an UpdateChannels<Mask>() mask from a channel table
+constexpr uint16_t channel_table_mask(const uint8_t *table, uint8_t count) {
+    return count == 0 ? 0 : (uint16_t)((1u << table[count - 1]) | channel_table_mask(table, count - 1));
+}
+
+// Most samples a window keeps per channel. 16 x 11-bit samples still sum
+// in 16 bits, and at 500 Hz and above a window stops growing past 32 ms.
+#define TRACKER_SAMPLES_MAX 16
+
+// Window capacity that holds window_ms at the fastest frame rate, capped at
+// TRACKER_SAMPLES_MAX; above the rate the cap covers, the window is shorter
+#define TRACKER_FRAMES(window_ms) ((window_ms) * 1000UL / FRAME_PERIOD_MIN_US)
+#define TRACKER_CAPACITY(window_ms) \
+    ((uint8_t)(TRACKER_FRAMES(window_ms) < TRACKER_SAMPLES_MAX ? TRACKER_FRAMES(window_ms) : TRACKER_SAMPLES_MAX))
+
+// Moving average over the last frames for C channels at once.
+// All channels share one head index and advance together, samples are stored
+// channel-major (each channel's window is contiguous) and the running sums sit
+// side by side, so a frame is one pass over the channel table. Slot c of the
+// tracker follows frame channel channel_table[c].
+//
+// N is the capacity. Given a window in milliseconds, retime() sets how many
+// of the N slots are in use so the window covers the same time at the
+// measured frame rate, up to N frames (size N with TRACKER_CAPACITY);
+// without one the window is always N frames. The average divides by a
+// reciprocal precomputed for the active length, corrected to the exact quotient.
+//
+// Shift drops that many low bits from every stored sample, so channels that
+// only feed thresholds can keep uint8_t samples (Shift 3: 8-count steps). The
+// average is scaled back up and taken from the middle of each step.
+template <uint8_t C, uint8_t N = HISTORY_SIZE, typename T = uint16_t, typename S = uint16_t, uint8_t Shift = 0>
+class MultiChannelTracker {
+    private:
+        static constexpr uint16_t SAMPLE_MAX = SBUS_TRACKER_SAMPLE_MAX >> Shift;
+        static constexpr uint16_t HALF_STEP = Shift ? 1u << (Shift - 1) : 0;
+
+        static_assert(C > 0 && N > 0, "MultiChannelTracker needs at least one channel and one sample");
+        static_assert(N <= 64, "MultiChannelTracker holds at most 64 samples per channel");
+        static_assert(SAMPLE_MAX <= (T)~(T)0, "sample type too small, raise Shift");
+        static_assert((uint32_t)N * SAMPLE_MAX <= (S)~(S)0, "running sum type too small for N samples");
+
+        const uint8_t *channel_table;
+        uint16_t window_ms;
+        T samples[C][N];
+        S rolling_sums[C];
+        uint8_t head_index;
+        uint8_t length;
+        uint16_t reciprocal; // 65536 / length, for length > 1
+
+        uint8_t length_for(uint16_t period_us) {
+            uint32_t frames = ((uint32_t)window_ms * 1000 + period_us / 2) / period_us;
+            return frames < 1 ? 1 : (frames > N ? N : (uint8_t)frames);
+        }
+
+    public:
+        MultiChannelTracker(const uint8_t *channel_table, uint16_t window_ms = 0)
+            : channel_table(channel_table), window_ms(window_ms) {
+            for (uint8_t c = 0; c < C; c++) {
+                rolling_sums[c] = 0;
+                for (uint8_t i = 0; i < N; i++) {
+                    samples[c][i] = 0;
+                }
+            }
+            head_index = 0;
+            length = 1;
+            reciprocal = 0;
+            set_length(window_ms ? length_for(FRAME_PERIOD_DEFAULT_US) : N);
+        }
+
+        // Average over n frames from now on. Each channel's window restarts
+        // filled with its current average, so the output does not jump.
+        void set_length(uint8_t n) {
+            if (n < 1) n = 1;
+            if (n > N) n = N;
+            if (n == length) {
+                return;
+            }
+            for (uint8_t c = 0; c < C; c++) {
+                T estimate = get_estimated(c) >> Shift;
+                rolling_sums[c] = 0;
+                for (uint8_t i = 0; i < n; i++) {
+                    samples[c][i] = estimate;
+                    rolling_sums[c] += estimate;
+                }
+            }
+            length = n;
+            reciprocal = n > 1 ? (uint16_t)(65536UL / n) : 0;
+            head_index = 0;
+        }
+
+        // New frame period; keeps the window at window_ms if one was given
+        void retime(uint16_t period_us) {
+            if (window_ms) {
+                set_length(length_for(period_us));
+            }
+        }
+
+        // Push one frame; values is indexed by frame channel (FUTABA_SBUS::channels)
+        void add(const int16_t *values) {
+            for (uint8_t c = 0; c < C; c++) {
+                T sample = (uint16_t)values[channel_table[c]] >> Shift;
+                T &slot = samples[c][head_index];
+                rolling_sums[c] += sample - slot;
+                slot = sample;
+            }
+            if (++head_index == length) {
+                head_index = 0;
+            }
+        }
+
+        uint8_t get_length() {
+            return length;
+        }
+
+        unsigned int get_head_index() {
+            return head_index;
+        }
+
+        S get_rolling_sum(uint8_t c) {
+            return rolling_sums[c];
+        }
+
+        unsigned int get_estimated(uint8_t c) {
+            uint32_t sum = ((uint32_t)rolling_sums[c] << Shift) + (uint32_t)HALF_STEP * length;
+            if (length == 1) {
+                return sum;
+            }
+            // The reciprocal rounds down, so this is at most two below the quotient
+            uint32_t estimate = (sum * reciprocal) >> 16;
+            while ((estimate + 1) * length <= sum) {
+                estimate++;
+            }
+            return estimate;
+        }
+};
+
+// Stands in for a MultiChannelTracker nothing reads: same interface, no
+// storage and no per-frame work
+template <uint8_t C>
+class NullTracker {
+    public:
+        NullTracker(const uint8_t *, uint16_t = 0) {}
+
+        void set_length(uint8_t) {}
+
+        void retime(uint16_t) {}
+
+        void add(const int16_t *) {}
+
+        uint8_t get_length() {
+            return 1;
+        }
+
+        unsigned int get_estimated(uint8_t) {
+            return 0;
+        }
+};
+
+// MultiChannelTracker<C, N, T, S, Shift> when Used, otherwise a NullTracker<C>, so a
+// tracker selected away by a compile-time setting costs neither SRAM nor cycles
+template <bool Used, uint8_t C, uint8_t N = HISTORY_SIZE, typename T = uint16_t, typename S = uint16_t, uint8_t Shift = 0>
+struct TrackerIf {
+    typedef MultiChannelTracker<C, N, T, S, Shift> Type;
+};
+
+template <uint8_t C, uint8_t N, typename T, typename S, uint8_t Shift>
+struct TrackerIf<false, C, N, T, S, Shift> {
+    typedef NullTracker<C> Type;
+};
+
+#endif
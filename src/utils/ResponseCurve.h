@@ -0,0 +1,45 @@
+// ResponseCurve.h
+#ifndef RESPONSE_CURVE_H
+#define RESPONSE_CURVE_H
+
+#include <Arduino.h>
+
+#define RESPONSE_CURVE_CENTER 992
+#define RESPONSE_CURVE_HALF_SPAN 819 // center to full deflection
+#define RESPONSE_CURVE_SEGMENT_SHIFT 5 // 32 input counts per table segment
+#define RESPONSE_CURVE_POINTS 27
+
+// Stick response shaping (deadband, expo, rate), kept in flash. Tables are
+// generated by tools/gen_response_curves.py into ResponseCurveTables.h; edit
+// the curves there and regenerate rather than editing the numbers.
+// Inputs within deadband counts of center read as center and inputs past full
+// deflection as full deflection. In between, points[i] is the output offset
+// from center at deadband + i * 2^SEGMENT_SHIFT counts; the negative half
+// mirrors the positive one.
+struct ResponseCurve {
+    uint16_t deadband;
+    uint16_t points[RESPONSE_CURVE_POINTS];
+};
+
+// Three flash reads, a multiply and a shift
+inline long response_curve(const ResponseCurve *curve, long value) {
+    long offset = value - RESPONSE_CURVE_CENTER;
+    bool negative = offset < 0;
+    uint16_t magnitude = negative ? -offset : offset;
+    uint16_t deadband = pgm_read_word(&curve->deadband);
+    if (magnitude <= deadband) {
+        return RESPONSE_CURVE_CENTER;
+    }
+    if (magnitude > RESPONSE_CURVE_HALF_SPAN) {
+        magnitude = RESPONSE_CURVE_HALF_SPAN;
+    }
+    magnitude -= deadband;
+    uint16_t index = magnitude >> RESPONSE_CURVE_SEGMENT_SHIFT;
+    uint16_t frac = magnitude & ((1 << RESPONSE_CURVE_SEGMENT_SHIFT) - 1);
+    uint16_t low = pgm_read_word(&curve->points[index]);
+    uint16_t high = pgm_read_word(&curve->points[index + 1]);
+    uint16_t shaped = low + (uint16_t)(((uint16_t)(high - low) * frac) >> RESPONSE_CURVE_SEGMENT_SHIFT);
+    return negative ? RESPONSE_CURVE_CENTER - (long)shaped : RESPONSE_CURVE_CENTER + (long)shaped;
+}
+
+#endif
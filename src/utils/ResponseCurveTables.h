@@ -0,0 +1,41 @@
+// ResponseCurveTables.h
+// Generated by tools/gen_response_curves.py, do not edit by hand.
+#ifndef RESPONSE_CURVE_TABLES_H
+#define RESPONSE_CURVE_TABLES_H
+
+#include "ResponseCurve.h"
+
+#if RESPONSE_CURVE_CENTER != 992 || RESPONSE_CURVE_HALF_SPAN != 819 \
+    || RESPONSE_CURVE_SEGMENT_SHIFT != 5 || RESPONSE_CURVE_POINTS != 27
+#error ResponseCurve.h does not match tools/gen_response_curves.py, regenerate the tables
+#endif
+
+// X: deadband 0.00, expo 0.00, rate 1.00
+static const ResponseCurve responseCurveX PROGMEM = { 0, {
+       0,   32,   64,   96,  128,  160,  192,  224,  256,  288,  320,
+     352,  384,  416,  448,  480,  512,  544,  576,  608,  640,  672,
+     704,  736,  768,  800,  832,
+} };
+
+// Y: deadband 0.00, expo 0.00, rate 1.00
+static const ResponseCurve responseCurveY PROGMEM = { 0, {
+       0,   32,   64,   96,  128,  160,  192,  224,  256,  288,  320,
+     352,  384,  416,  448,  480,  512,  544,  576,  608,  640,  672,
+     704,  736,  768,  800,  832,
+} };
+
+// Rx: deadband 0.00, expo 0.00, rate 1.00
+static const ResponseCurve responseCurveRx PROGMEM = { 0, {
+       0,   32,   64,   96,  128,  160,  192,  224,  256,  288,  320,
+     352,  384,  416,  448,  480,  512,  544,  576,  608,  640,  672,
+     704,  736,  768,  800,  832,
+} };
+
+// Ry: deadband 0.00, expo 0.00, rate 1.00
+static const ResponseCurve responseCurveRy PROGMEM = { 0, {
+       0,   32,   64,   96,  128,  160,  192,  224,  256,  288,  320,
+     352,  384,  416,  448,  480,  512,  544,  576,  608,  640,  672,
+     704,  736,  768,  800,  832,
+} };
+
+#endif
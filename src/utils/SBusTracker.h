@@ -1,26 +1,76 @@
 // SBusTracker.h
+#ifndef SBUS_TRACKER_H
+#define SBUS_TRACKER_H
+
 #include <Arduino.h>
 
-#define HISTORY_SIZE 9
+#define HISTORY_SIZE 9 // default window in frames; MultiChannelTracker can size it in milliseconds instead
+#define SBUS_TRACKER_SAMPLE_MAX 2047 // 11-bit channel values
 
+// Moving average over the last N samples.
+// When N is a power of two the ring index wraps with a mask and the average is
+// a shift; other sizes wrap with a compare and divide as before. T is the
+// sample storage type and S the running-sum type, which must hold N samples.
+template <uint8_t N = HISTORY_SIZE, typename T = uint16_t, typename S = uint16_t>
 class SBusTracker {
     private:
-        int tracker_array[HISTORY_SIZE];
-        unsigned int head_index;
-        unsigned int rolling_sum;
+        static constexpr bool POW2 = (N & (N - 1)) == 0;
+
+        static constexpr uint8_t log2_of(uint8_t n) {
+            return n <= 1 ? 0 : 1 + log2_of(n >> 1);
+        }
+
+        static_assert(N > 0, "SBusTracker needs at least one sample");
+        static_assert((uint32_t)N * SBUS_TRACKER_SAMPLE_MAX <= (S)~(S)0, "running sum type too small for N samples");
+
+        T tracker_array[N];
+        uint8_t head_index;
+        S rolling_sum;
 
     public:
-        SBusTracker(int pre_load);
+        SBusTracker(T pre_load) {
+            rolling_sum = 0;
+            head_index = 0;
+            for (uint8_t i = 0; i < N; i++) {
+                rolling_sum += pre_load;
+                tracker_array[i] = pre_load;
+            }
+        }
 
         SBusTracker() : SBusTracker(0) {};
 
-        void add(int instance);
+        void add(T instance) {
+            rolling_sum -= tracker_array[head_index];
+            rolling_sum += instance;
+            tracker_array[head_index] = instance;
+            if (POW2) {
+                head_index = (head_index + 1) & (N - 1);
+            } else if (++head_index == N) {
+                head_index = 0;
+            }
+        }
+
+        unsigned int get_head_index() {
+            return head_index;
+        }
 
-        unsigned int get_head_index();
+        unsigned int get_rolling_sum() {
+            return rolling_sum;
+        }
 
-        unsigned int get_rolling_sum();
+        unsigned int get_estimated() {
+            return POW2 ? (rolling_sum >> log2_of(N)) : (rolling_sum / N);
+        }
 
-        unsigned int get_estimated();
+        void print_arr(Serial_ & printer) {
+            printer.print(head_index);
+            printer.print(" : {");
+            for (uint8_t i = 0; i < N; i++) {
+                printer.print(tracker_array[i]);
+                printer.print(", ");
+            }
+            printer.println("}");
+        }
+};
 
-        void print_arr(Serial_ & prtinter);
-};
\ No newline at end of file
+#endif
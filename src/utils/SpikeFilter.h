@@ -0,0 +1,83 @@
+// SpikeFilter.h
+#ifndef SPIKE_FILTER_H
+#define SPIKE_FILTER_H
+
+#include <Arduino.h>
+#include "FrameRate.h"
+
+// Rejects physically impossible jumps on C channels before they reach the
+// trackers. Slot c follows frame channel channel_table[c] and may move at most
+// slew_table[c] counts per millisecond; the limit is turned into counts per
+// frame on retime(). A sample beyond the limit is replaced by the last good
+// value and counted. A jump is only accepted once the next sample confirms it
+// (lands within the limit of the rejected value), so a one-frame glitch such
+// as 0 or 2047 is dropped while a real step costs one frame.
+template <uint8_t C>
+class SpikeFilter {
+    private:
+        static_assert(C > 0 && C <= 16, "SpikeFilter holds 1 to 16 channels");
+
+        const uint8_t *channel_table;
+        const uint8_t *slew_table;
+        uint16_t limits[C];
+        int16_t last[C];
+        int16_t pending[C];
+        uint16_t pending_mask;
+        uint16_t rejects[C];
+        bool primed;
+
+        static uint16_t distance(int16_t a, int16_t b) {
+            return a > b ? a - b : b - a;
+        }
+
+    public:
+        SpikeFilter(const uint8_t *channel_table, const uint8_t *slew_table)
+            : channel_table(channel_table), slew_table(slew_table) {
+            for (uint8_t c = 0; c < C; c++) {
+                rejects[c] = 0;
+            }
+            retime(FRAME_PERIOD_DEFAULT_US);
+            reset();
+        }
+
+        // Take the next frame as-is, e.g. after a link dropout
+        void reset() {
+            pending_mask = 0;
+            primed = false;
+        }
+
+        void retime(uint16_t period_us) {
+            for (uint8_t c = 0; c < C; c++) {
+                uint32_t limit = ((uint32_t)slew_table[c] * period_us + 500) / 1000;
+                limits[c] = limit > 0xFFFF ? 0xFFFF : (limit == 0 ? 1 : limit);
+            }
+        }
+
+        // Filters values (indexed by frame channel) in place, returns a bit per rejected slot
+        uint16_t filter(int16_t *values) {
+            uint16_t rejected = 0;
+            for (uint8_t c = 0; c < C; c++) {
+                int16_t &value = values[channel_table[c]];
+                uint16_t bit = 1u << c;
+                if (!primed || distance(value, last[c]) <= limits[c]
+                    || ((pending_mask & bit) && distance(value, pending[c]) <= limits[c])) {
+                    last[c] = value;
+                    pending_mask &= ~bit;
+                    continue;
+                }
+                pending[c] = value;
+                pending_mask |= bit;
+                value = last[c];
+                rejects[c]++;
+                rejected |= bit;
+            }
+            primed = true;
+            return rejected;
+        }
+
+        uint16_t get_rejects(uint8_t c) {
+            return rejects[c];
+        }
+};
+
+#endif
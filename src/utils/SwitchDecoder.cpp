@@ -0,0 +1,32 @@
+#include "SwitchDecoder.h"
+
+
+uint8_t SwitchDecoder::update(const SwitchProfile &profile, long raw, uint16_t period_us) {
+    // Position the sample points at, seen from the committed one. Only one of
+    // the two walks can move since fall[i] < rise[i].
+    uint8_t target = current;
+    while (target + 1 < profile.positions && raw > profile.rise[target]) {
+        target++;
+    }
+    while (target > 0 && raw < profile.fall[target - 1]) {
+        target--;
+    }
+
+    if (target == current) {
+        held = 0;
+        return current;
+    }
+    if (target != candidate) {
+        // A different position restarts the confirmation time
+        candidate = target;
+        held = 0;
+    }
+    uint16_t ticks = period_us / SWITCH_TICK_US;
+    held = held > 0xFFFF - ticks ? 0xFFFF : held + ticks;
+    // Commit once the candidate has lasted the debounce time, give or take half a frame
+    if ((uint32_t)held + ticks / 2 > profile.debounce[target]) {
+        current = target;
+        held = 0;
+    }
+    return current;
+}
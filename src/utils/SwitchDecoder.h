@@ -0,0 +1,121 @@
+// SwitchDecoder.h
+#ifndef SWITCH_DECODER_H
+#define SWITCH_DECODER_H
+
+#include <Arduino.h>
+
+#define SWITCH_POSITIONS_MAX 6
+#define SWITCH_TICK_US 16 // debounce time unit, up to ~1 s fits in 16 bits
+
+enum TriSwitchMode
+{
+    DOWN = 0,
+    MID = 1,
+    UP = 2,
+};
+
+enum ButtonMode
+{
+    OFF = 0,
+    ON = 1,
+};
+
+// Thresholds of one kind of switch. Positions are numbered from the lowest
+// raw value up. Boundary i sits between positions i and i+1: the switch moves
+// up across it once raw > rise[i] and back down once raw < fall[i], so
+// fall[i] < rise[i] gives the hysteresis band. A new position must be seen for
+// debounce[p] (SWITCH_TICK_US units) before it is committed. Time is counted in
+// whole frames, rounded to the nearest, so it holds at any packet rate.
+struct SwitchProfile {
+    uint8_t positions;
+    uint8_t initial;
+    int16_t rise[SWITCH_POSITIONS_MAX - 1];
+    int16_t fall[SWITCH_POSITIONS_MAX - 1];
+    uint16_t debounce[SWITCH_POSITIONS_MAX];
+};
+
+constexpr uint16_t switch_ticks(uint16_t ms) {
+    return (uint16_t)((uint32_t)ms * 1000 / SWITCH_TICK_US);
+}
+
+// Two-position switch or button, starts OFF
+constexpr SwitchProfile button_profile(int16_t enter, int16_t exit, uint16_t debounce_ms) {
+    return SwitchProfile{ 2, OFF, { enter }, { exit }, { switch_ticks(debounce_ms), switch_ticks(debounce_ms) } };
+}
+
+// Three-position switch, starts MID
+constexpr SwitchProfile tri_switch_profile(int16_t up_enter, int16_t up_exit,
+                                           int16_t down_enter, int16_t down_exit, uint16_t debounce_ms) {
+    return SwitchProfile{ 3, MID, { down_exit, up_enter }, { down_enter, up_exit },
+                          { switch_ticks(debounce_ms), switch_ticks(debounce_ms), switch_ticks(debounce_ms) } };
+}
+
+// State of one switch. The profile is passed on each update rather than
+// stored, so a decoder is four bytes and can sit in arrays or filter stages.
+class SwitchDecoder {
+    private:
+        uint8_t current;
+        uint8_t candidate;
+        uint16_t held; // ticks the candidate has been seen for
+
+    public:
+        SwitchDecoder(uint8_t initial = 0) : current(initial), candidate(initial), held(0) {};
+
+        SwitchDecoder(const SwitchProfile &profile) : SwitchDecoder(profile.initial) {};
+
+        // Returns the committed position after taking this sample, which
+        // stands for period_us of time, into account
+        uint8_t update(const SwitchProfile &profile, long raw, uint16_t period_us);
+
+        uint8_t position() {
+            return current;
+        }
+};
+
+// C switches decoded together in one pass. Slot c is decoded with
+// *profiles[c]; a slot whose profile is NULL is not a switch and is skipped.
+// update() walks the slots in a single loop, each costing at most one
+// threshold compare per boundary, so the per-frame cost grows linearly and
+// predictably with the number of switches.
+template <uint8_t C>
+class SwitchBank {
+    private:
+        static_assert(C > 0 && C <= 16, "SwitchBank holds 1 to 16 switches");
+
+        const SwitchProfile *const *profiles;
+        SwitchDecoder decoders[C];
+
+    public:
+        SwitchBank(const SwitchProfile *const *profiles) : profiles(profiles) {
+            reset();
+        }
+
+        // Every switch back to its profile's initial position
+        void reset() {
+            for (uint8_t c = 0; c < C; c++) {
+                decoders[c] = profiles[c] ? SwitchDecoder(*profiles[c]) : SwitchDecoder();
+            }
+        }
+
+        // Takes one value per slot, each standing for period_us of time.
+        // Returns a bit per slot that changed position.
+        uint16_t update(const long *values, uint16_t period_us) {
+            uint16_t changed = 0;
+            for (uint8_t c = 0; c < C; c++) {
+                if (!profiles[c]) {
+                    continue;
+                }
+                uint8_t before = decoders[c].position();
+                if (decoders[c].update(*profiles[c], values[c], period_us) != before) {
+                    changed |= 1u << c;
+                }
+            }
+            return changed;
+        }
+
+        uint8_t position(uint8_t c) {
+            return decoders[c].position();
+        }
+};
+
+#endif
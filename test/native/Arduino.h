@@ -0,0 +1,80 @@
+// Arduino.h
+#ifndef NATIVE_ARDUINO_H
+#define NATIVE_ARDUINO_H
+
+// Just enough of the Arduino core for the [env:native] unit tests to build
+// the libraries and src/utils on the host. Registers are plain variables the
+// tests can inspect, and the time functions are defined by each test so it
+// can move the clock itself.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#ifndef F_CPU
+#define F_CPU 16000000UL
+#endif
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define HIGH 1
+#define LOW 0
+
+#define B00000001 1
+#define B00000010 2
+#define B00000100 4
+#define B00001000 8
+#define B00010000 16
+#define B00100000 32
+#define B00011111 31
+#define B00111111 63
+
+#define _BV(bit) (1 << (bit))
+
+#define PROGMEM
+#define pgm_read_byte(addr) (*(const uint8_t *)(addr))
+#define pgm_read_word(addr) (*(const uint16_t *)(addr))
+#define memcpy_P memcpy
+
+#define ISR(vector) extern "C" void vector(void)
+
+unsigned long micros(void);
+unsigned long millis(void);
+
+// USART1, see SBUS_UART
+struct NativeRegisters {
+    volatile uint8_t ucsr1a, ucsr1b, ucsr1c, udr1;
+    volatile uint16_t ubrr1;
+};
+inline NativeRegisters &native_registers() {
+    static NativeRegisters registers = { _BV(5), 0, 0, 0, 0 }; // UDRE1: transmitter ready
+    return registers;
+}
+#define UCSR1A (native_registers().ucsr1a)
+#define UCSR1B (native_registers().ucsr1b)
+#define UCSR1C (native_registers().ucsr1c)
+#define UDR1 (native_registers().udr1)
+#define UBRR1 (native_registers().ubrr1)
+#define RXC1 7
+#define TXC1 6
+#define UDRE1 5
+#define FE1 4
+#define DOR1 3
+#define U2X1 1
+#define RXCIE1 7
+#define RXEN1 4
+#define TXEN1 3
+#define UCSZ11 2
+#define UCSZ10 1
+
+// Declared so headers that can print (SBusTracker::print_arr) compile
+struct Print {
+    size_t print(const char *);
+    size_t print(long, int = 10);
+    size_t println(const char *);
+    size_t println(long, int = 10);
+};
+struct Serial_ : public Print {};
+
+#endif
@@ -0,0 +1,10 @@
+// util/atomic.h
+#ifndef NATIVE_UTIL_ATOMIC_H
+#define NATIVE_UTIL_ATOMIC_H
+
+// The host tests have no interrupts, so an atomic block is a plain block
+#define ATOMIC_RESTORESTATE
+#define ATOMIC_FORCEON
+#define ATOMIC_BLOCK(type) for (bool native_atomic_once = true; native_atomic_once; native_atomic_once = false)
+
+#endif
@@ -0,0 +1,127 @@
+// AlphaBetaPredictor, run with `pio test -e native`.
+// There are no recorded captures in the tree: the traces here are synthetic
+// (ramps and a 250 Hz sine sweep with noise), so this checks the predictor's
+// behaviour and clamping, not the tuning of the gains on real sticks.
+#include <unity.h>
+#include <math.h>
+#include "utils/AlphaBetaPredictor.h"
+
+unsigned long micros(void) {
+    return 0;
+}
+
+unsigned long millis(void) {
+    return 0;
+}
+
+// The gains main.cpp uses (0.7 / 0.31)
+typedef AlphaBetaPredictor<179, 80> Predictor;
+
+#define ONE_FRAME_Q8 256
+
+static uint32_t noise_state;
+
+// Deterministic noise in [-amplitude, amplitude]
+static long noise(long amplitude) {
+    noise_state = noise_state * 1103515245u + 12345u;
+    return (long)((noise_state >> 16) % (2 * amplitude + 1)) - amplitude;
+}
+
+void setUp(void) {
+    noise_state = 1;
+}
+
+void tearDown(void) {
+}
+
+void test_holds_a_still_stick(void) {
+    Predictor predictor;
+    for (uint8_t i = 0; i < 50; i++) {
+        predictor.update(992);
+    }
+    TEST_ASSERT_EQUAL(992, predictor.predict(0));
+    TEST_ASSERT_EQUAL(992, predictor.predict(ONE_FRAME_Q8));
+}
+
+void test_ramp_predicts_next_sample(void) {
+    // At constant velocity the one-frame prediction lands on the next sample
+    Predictor predictor;
+    long sample = 200;
+    for (uint8_t i = 0; i < 60; i++) {
+        predictor.update(sample);
+        sample += 12;
+    }
+    TEST_ASSERT_INT_WITHIN(1, sample, predictor.predict(ONE_FRAME_Q8));
+    TEST_ASSERT_INT_WITHIN(1, sample - 6, predictor.predict(ONE_FRAME_Q8 / 2));
+}
+
+void test_one_frame_error_below_hold(void) {
+    // Sine sweeps of several speeds with +-2 counts of noise; the error of
+    // predicting the next sample, against repeating the last one
+    Predictor predictor;
+    double predicted_sq = 0;
+    double held_sq = 0;
+    long last = 0;
+    uint16_t count = 0;
+    for (uint16_t i = 0; i < 2000; i++) {
+        double hz = 0.5 + (i / 500) * 0.75;  // 0.5 to 2.75 Hz at 250 frames/s
+        long sample = 992 + (long)lround(700 * sin(2 * M_PI * hz * i / 250.0)) + noise(2);
+        if (i >= 20) {
+            double predicted_error = (double)(predictor.predict(ONE_FRAME_Q8) - sample);
+            double held_error = (double)(last - sample);
+            predicted_sq += predicted_error * predicted_error;
+            held_sq += held_error * held_error;
+            count++;
+        }
+        predictor.update(sample);
+        last = sample;
+    }
+    double predicted_rms = sqrt(predicted_sq / count);
+    double held_rms = sqrt(held_sq / count);
+    TEST_ASSERT_TRUE(predicted_rms < held_rms);
+}
+
+void test_lead_is_clamped_to_one_frame(void) {
+    Predictor predictor;
+    long sample = 200;
+    for (uint8_t i = 0; i < 60; i++) {
+        predictor.update(sample);
+        sample += 12;
+    }
+    TEST_ASSERT_EQUAL(predictor.predict(ONE_FRAME_Q8), predictor.predict(4 * ONE_FRAME_Q8));
+}
+
+void test_output_stays_in_range(void) {
+    Predictor up;
+    Predictor down;
+    for (uint8_t i = 0; i < 30; i++) {
+        up.update(1200 + 30 * i);
+        down.update(800 - 30 * i);
+    }
+    up.update(SBUS_TRACKER_SAMPLE_MAX);
+    down.update(0);
+    TEST_ASSERT_EQUAL(SBUS_TRACKER_SAMPLE_MAX, up.predict(ONE_FRAME_Q8));
+    TEST_ASSERT_EQUAL(0, down.predict(ONE_FRAME_Q8));
+}
+
+void test_glitch_velocity_is_clamped(void) {
+    // A full-scale jump cannot push the velocity past PREDICT_VELOCITY_MAX
+    Predictor predictor;
+    for (uint8_t i = 0; i < 10; i++) {
+        predictor.update(0);
+    }
+    predictor.update(SBUS_TRACKER_SAMPLE_MAX);
+    long position = predictor.predict(0);
+    TEST_ASSERT_TRUE(predictor.predict(ONE_FRAME_Q8) - position <= PREDICT_VELOCITY_MAX);
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_holds_a_still_stick);
+    RUN_TEST(test_ramp_predicts_next_sample);
+    RUN_TEST(test_one_frame_error_below_hold);
+    RUN_TEST(test_lead_is_clamped_to_one_frame);
+    RUN_TEST(test_output_stays_in_range);
+    RUN_TEST(test_glitch_velocity_is_clamped);
+    return UNITY_END();
+}
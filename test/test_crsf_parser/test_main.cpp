@@ -0,0 +1,218 @@
+// CRSF stream parsing in FUTABA_SBUS::FeedLine(), run with `pio test -e native`.
+// Byte streams go in through the SBUS_UART ISR path, so the parser sees them
+// exactly as it would from the link: hunting for sync, checking the length,
+// folding each byte into the CRC8 and dispatching whole frames by type.
+#include <unity.h>
+#include <FUTABA_SBUS.h>
+
+static unsigned long clock_us;
+
+unsigned long micros(void) {
+    return clock_us;
+}
+
+unsigned long millis(void) {
+    return clock_us / 1000;
+}
+
+static FUTABA_SBUS sBus;
+
+// Bitwise DVB-S2 CRC8, independent of the library's table
+static uint8_t reference_crc(const uint8_t *data, uint8_t length) {
+    uint8_t crc = 0;
+    for (uint8_t i = 0; i < length; i++) {
+        crc ^= data[i];
+        for (uint8_t bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0xD5) : (uint8_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+// [sync][length][type][payload ...][crc] into frame, returns its size
+static uint8_t build_frame(uint8_t *frame, uint8_t type, const uint8_t *payload, uint8_t length) {
+    frame[0] = CRSF_ADDRESS_FLIGHT_CONTROLLER;
+    frame[1] = length + 2;
+    frame[2] = type;
+    memcpy(&frame[3], payload, length);
+    frame[3 + length] = reference_crc(&frame[2], length + 1);
+    return length + 4;
+}
+
+// RC channels frame carrying channel n = base + n
+static uint8_t rc_frame(uint8_t *frame, int16_t base) {
+    uint8_t payload[CRSF_RC_CHANNELS_PACKED_PAYLOAD_SIZE] = { 0 };
+    for (uint8_t n = 0; n < 16; n++) {
+        uint16_t value = (base + n) & 0x07FF;
+        for (uint8_t bit = 0; bit < 11; bit++) {
+            if (value & (1 << bit)) {
+                payload[(n * 11 + bit) / 8] |= 1 << ((n * 11 + bit) % 8);
+            }
+        }
+    }
+    return build_frame(frame, CRSF_FRAMETYPE_RC_CHANNELS_PACKED, payload, sizeof(payload));
+}
+
+static void send(const uint8_t *bytes, uint8_t count) {
+    for (uint8_t i = 0; i < count; i++) {
+        SBUS_UART::receive(bytes[i], 0);
+    }
+}
+
+// Runs FeedLine() until the ring is empty, returns the RC frames it latched
+static uint8_t feed(void) {
+    uint8_t latched = 0;
+    do {
+        sBus.FeedLine();
+        if (sBus.toChannels == 1) {
+            sBus.UpdateChannels<SBUS_ALL_CHANNELS_MASK>();
+            sBus.toChannels = 0;
+            latched++;
+        }
+    } while (SBUS_UART::available());
+    return latched;
+}
+
+static void assert_channels(int16_t base) {
+    for (uint8_t n = 0; n < 16; n++) {
+        TEST_ASSERT_EQUAL((base + n) & 0x07FF, sBus.channels[n]);
+    }
+}
+
+void setUp(void) {
+    clock_us = 0;
+    sBus.begin();
+}
+
+void tearDown(void) {
+}
+
+void test_clean_frame_accepted(void) {
+    uint8_t frame[CRSF_FRAME_SIZE_MAX];
+    send(frame, rc_frame(frame, 1000));
+    TEST_ASSERT_EQUAL(1, feed());
+    assert_channels(1000);
+    TEST_ASSERT_EQUAL(0, sBus.bytesDiscarded);
+    TEST_ASSERT_EQUAL(0, sBus.resyncCount);
+    TEST_ASSERT_EQUAL(0, sBus.crcErrors);
+}
+
+void test_garbage_before_sync_discarded(void) {
+    const uint8_t garbage[] = { 0x00, 0x55, 0x16, 0x18, 0xFF };
+    uint8_t frame[CRSF_FRAME_SIZE_MAX];
+    send(garbage, sizeof(garbage));
+    send(frame, rc_frame(frame, 500));
+    TEST_ASSERT_EQUAL(1, feed());
+    assert_channels(500);
+    TEST_ASSERT_EQUAL(sizeof(garbage), sBus.bytesDiscarded);
+    TEST_ASSERT_EQUAL(0, sBus.resyncCount);
+    TEST_ASSERT_EQUAL(0, sBus.crcErrors);
+}
+
+void test_bad_length_resyncs_on_next_byte(void) {
+    // A sync byte followed by an impossible length: both are dropped
+    const uint8_t shortLength[] = { CRSF_ADDRESS_FLIGHT_CONTROLLER, CRSF_FRAME_LENGTH_MIN - 1 };
+    uint8_t frame[CRSF_FRAME_SIZE_MAX];
+    send(shortLength, sizeof(shortLength));
+    send(frame, rc_frame(frame, 200));
+    TEST_ASSERT_EQUAL(1, feed());
+    assert_channels(200);
+    TEST_ASSERT_EQUAL(1, sBus.resyncCount);
+    TEST_ASSERT_EQUAL(2, sBus.bytesDiscarded);
+
+    // A rejected length byte that is itself a sync byte starts the next frame
+    sBus.begin();
+    const uint8_t doubledSync[] = { CRSF_ADDRESS_CRSF_RECEIVER };
+    send(doubledSync, sizeof(doubledSync));
+    send(frame, rc_frame(frame, 300));
+    TEST_ASSERT_EQUAL(1, feed());
+    assert_channels(300);
+    TEST_ASSERT_EQUAL(1, sBus.resyncCount);
+    TEST_ASSERT_EQUAL(1, sBus.bytesDiscarded);
+}
+
+void test_corrupted_crc_rejected(void) {
+    uint8_t frame[CRSF_FRAME_SIZE_MAX];
+    uint8_t size = rc_frame(frame, 1500);
+    frame[size - 1] ^= 0x01;
+    send(frame, size);
+    TEST_ASSERT_EQUAL(0, feed());
+    TEST_ASSERT_EQUAL(1, sBus.crcErrors);
+
+    // A flipped payload bit fails the check as well
+    size = rc_frame(frame, 1500);
+    frame[10] ^= 0x40;
+    send(frame, size);
+    TEST_ASSERT_EQUAL(0, feed());
+    TEST_ASSERT_EQUAL(2, sBus.crcErrors);
+
+    // The next good frame is accepted straight away
+    send(frame, rc_frame(frame, 1600));
+    TEST_ASSERT_EQUAL(1, feed());
+    assert_channels(1600);
+    TEST_ASSERT_EQUAL(2, sBus.crcErrors);
+    TEST_ASSERT_EQUAL(0, sBus.resyncCount);
+    TEST_ASSERT_EQUAL(0, sBus.bytesDiscarded);
+}
+
+void test_split_frame_reassembled(void) {
+    uint8_t frame[CRSF_FRAME_SIZE_MAX];
+    uint8_t size = rc_frame(frame, 700);
+    clock_us = 1234;
+    send(frame, 1);
+    clock_us = 1300;
+    send(&frame[1], 9);
+    TEST_ASSERT_EQUAL(0, feed());
+    clock_us = 1400;
+    send(&frame[10], size - 10);
+    TEST_ASSERT_EQUAL(1, feed());
+    assert_channels(700);
+    // Stamped with the arrival of the sync byte, not the last one
+    TEST_ASSERT_EQUAL(1234, sBus.frameTimestamp);
+    TEST_ASSERT_EQUAL(0, sBus.crcErrors);
+}
+
+void test_other_frame_types_keep_sync(void) {
+    // Battery sensor (0x08), no handler: skipped whole
+    const uint8_t battery[8] = { 0x00, 0xA8, 0x00, 0x10, 0x00, 0x00, 0x00, 0x55 };
+    const uint8_t link[CRSF_LINK_STATISTICS_PAYLOAD_SIZE] = { 60, 62, 0, 5, 0, 4, 1, 70, 100, 8 };
+    uint8_t frame[CRSF_FRAME_SIZE_MAX];
+    send(frame, build_frame(frame, 0x08, battery, sizeof(battery)));
+    send(frame, build_frame(frame, CRSF_FRAMETYPE_LINK_STATISTICS, link, sizeof(link)));
+    send(frame, rc_frame(frame, 900));
+    TEST_ASSERT_EQUAL(1, feed());
+    assert_channels(900);
+    TEST_ASSERT_EQUAL(1, sBus.linkStatisticsCount);
+    TEST_ASSERT_EQUAL(SBUS_SIGNAL_FAILSAFE, sBus.Failsafe());
+    TEST_ASSERT_EQUAL(0, sBus.bytesDiscarded);
+    TEST_ASSERT_EQUAL(0, sBus.resyncCount);
+    TEST_ASSERT_EQUAL(0, sBus.crcErrors);
+}
+
+void test_one_frame_per_feed(void) {
+    // FeedLine() stops at each RC frame so loop() sees every one
+    uint8_t frame[CRSF_FRAME_SIZE_MAX];
+    uint8_t size = rc_frame(frame, 100);
+    send(frame, size);
+    send(frame, rc_frame(frame, 1100));
+    sBus.FeedLine();
+    TEST_ASSERT_EQUAL(1, sBus.toChannels);
+    TEST_ASSERT_EQUAL(size, SBUS_UART::available());
+    sBus.UpdateChannels<SBUS_ALL_CHANNELS_MASK>();
+    sBus.toChannels = 0;
+    assert_channels(100);
+    TEST_ASSERT_EQUAL(1, feed());
+    assert_channels(1100);
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_clean_frame_accepted);
+    RUN_TEST(test_garbage_before_sync_discarded);
+    RUN_TEST(test_bad_length_resyncs_on_next_byte);
+    RUN_TEST(test_corrupted_crc_rejected);
+    RUN_TEST(test_split_frame_reassembled);
+    RUN_TEST(test_other_frame_types_keep_sync);
+    RUN_TEST(test_one_frame_per_feed);
+    return UNITY_END();
+}
@@ -0,0 +1,144 @@
+// Failsafe watchdog and link quality tests, run with `pio test -e native`.
+// micros() is driven by the test, so frame gaps are injected by moving the
+// clock between frames the way loop() sees them.
+#include <unity.h>
+#include "utils/Failsafe.h"
+
+#define FRAME_PERIOD_US 4000UL // 250 Hz
+#define TIMEOUT_US (FAILSAFE_TIMEOUT_MS * 1000UL)
+
+static unsigned long clock_us;
+
+unsigned long micros(void) {
+    return clock_us;
+}
+
+unsigned long millis(void) {
+    return clock_us / 1000;
+}
+
+// One loop() pass: kick the watchdog if a frame arrived, then update
+static bool pass(Failsafe &failsafe, bool frame) {
+    if (frame) {
+        failsafe.frame_received(micros());
+    }
+    return failsafe.update(micros());
+}
+
+// Frames every FRAME_PERIOD_US for duration_us; returns true if failsafe was ever active
+static bool run_frames(Failsafe &failsafe, unsigned long duration_us) {
+    bool active = false;
+    for (unsigned long t = 0; t < duration_us; t += FRAME_PERIOD_US) {
+        active |= pass(failsafe, true);
+        clock_us += FRAME_PERIOD_US;
+    }
+    return active;
+}
+
+void setUp(void) {
+    clock_us = 1000000UL;
+}
+
+void tearDown(void) {
+}
+
+void test_starts_active_until_first_frame(void) {
+    Failsafe failsafe;
+    TEST_ASSERT_TRUE(pass(failsafe, false));
+    TEST_ASSERT_TRUE(failsafe.entered());
+    TEST_ASSERT_FALSE(failsafe.entered());
+    TEST_ASSERT_FALSE(pass(failsafe, true));
+    TEST_ASSERT_FALSE(failsafe.is_active());
+}
+
+void test_steady_frames_stay_inactive(void) {
+    Failsafe failsafe;
+    TEST_ASSERT_FALSE(run_frames(failsafe, 2000000UL));
+}
+
+void test_gap_at_timeout_is_tolerated(void) {
+    Failsafe failsafe;
+    pass(failsafe, true);
+    failsafe.entered();
+    clock_us += TIMEOUT_US;
+    TEST_ASSERT_FALSE(pass(failsafe, false));
+    TEST_ASSERT_FALSE(failsafe.entered());
+}
+
+void test_gap_past_timeout_enters_once(void) {
+    Failsafe failsafe;
+    pass(failsafe, true);
+    failsafe.entered();
+    clock_us += TIMEOUT_US + 1;
+    TEST_ASSERT_TRUE(pass(failsafe, false));
+    TEST_ASSERT_TRUE(failsafe.entered());
+    clock_us += FRAME_PERIOD_US;
+    TEST_ASSERT_TRUE(pass(failsafe, false));
+    TEST_ASSERT_FALSE(failsafe.entered());
+}
+
+void test_fresh_frame_recovers_and_rearms(void) {
+    Failsafe failsafe;
+    pass(failsafe, true);
+    clock_us += TIMEOUT_US + 1;
+    pass(failsafe, false);
+    failsafe.entered();
+    TEST_ASSERT_FALSE(run_frames(failsafe, 200000UL));
+    clock_us += 2 * TIMEOUT_US;
+    TEST_ASSERT_TRUE(pass(failsafe, false));
+    TEST_ASSERT_TRUE(failsafe.entered());
+}
+
+void test_gaps_shorter_than_timeout(void) {
+    // Dropped frames up to just inside the watchdog never trip it
+    Failsafe failsafe;
+    pass(failsafe, true);
+    failsafe.entered();
+    for (unsigned long gap = FRAME_PERIOD_US; gap <= TIMEOUT_US; gap += FRAME_PERIOD_US) {
+        for (unsigned long t = 0; t < gap; t += 1000) {
+            clock_us += 1000;
+            TEST_ASSERT_FALSE(pass(failsafe, false));
+        }
+        pass(failsafe, true);
+    }
+    TEST_ASSERT_FALSE(failsafe.entered());
+}
+
+void test_zero_link_quality_is_loss(void) {
+    Failsafe failsafe;
+    run_frames(failsafe, 100000UL);
+    failsafe.entered();
+    failsafe.set_link_quality(0);
+    TEST_ASSERT_TRUE(pass(failsafe, true));
+    TEST_ASSERT_TRUE(failsafe.entered());
+    // Frames keep arriving, but the link stays down until quality returns
+    TEST_ASSERT_TRUE(pass(failsafe, true));
+    failsafe.set_link_quality(1);
+    TEST_ASSERT_FALSE(pass(failsafe, true));
+    TEST_ASSERT_FALSE(failsafe.entered());
+}
+
+void test_micros_wrap(void) {
+    Failsafe failsafe;
+    clock_us = 0xFFFFFFFFUL - FRAME_PERIOD_US;
+    pass(failsafe, true);
+    failsafe.entered();
+    clock_us += FRAME_PERIOD_US * 2; // wraps past zero
+    TEST_ASSERT_FALSE(pass(failsafe, false));
+    clock_us += TIMEOUT_US;
+    TEST_ASSERT_TRUE(pass(failsafe, false));
+    TEST_ASSERT_TRUE(failsafe.entered());
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_starts_active_until_first_frame);
+    RUN_TEST(test_steady_frames_stay_inactive);
+    RUN_TEST(test_gap_at_timeout_is_tolerated);
+    RUN_TEST(test_gap_past_timeout_enters_once);
+    RUN_TEST(test_fresh_frame_recovers_and_rearms);
+    RUN_TEST(test_gaps_shorter_than_timeout);
+    RUN_TEST(test_zero_link_quality_is_loss);
+    RUN_TEST(test_micros_wrap);
+    return UNITY_END();
+}
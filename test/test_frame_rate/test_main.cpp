@@ -0,0 +1,111 @@
+// Frame period measurement, run with `pio test -e native`.
+// Frames are fed as 16-bit arrival stamps like FUTABA_SBUS::frameTimestamp;
+// lost frames simply leave a gap, as a CRC failure or dropout does.
+#include <unity.h>
+#include "utils/FrameRate.h"
+
+unsigned long micros(void) {
+    return 0;
+}
+
+unsigned long millis(void) {
+    return 0;
+}
+
+static uint16_t stamp;
+
+// Feeds frames period_us apart, losing every drop_every-th one (0 = none);
+// a lost frame only moves the clock. Returns true if the period was republished.
+static bool run(FrameRate &rate, uint16_t period_us, uint16_t frames, uint8_t drop_every = 0) {
+    bool changed = false;
+    for (uint16_t i = 1; i <= frames; i++) {
+        stamp += period_us;
+        if (drop_every && i % drop_every == 0) {
+            continue;
+        }
+        changed |= rate.frame(stamp);
+    }
+    return changed;
+}
+
+void setUp(void) {
+    stamp = 0x1234;
+}
+
+void tearDown(void) {
+}
+
+void test_first_interval_sets_the_period(void) {
+    FrameRate rate;
+    TEST_ASSERT_EQUAL(FRAME_PERIOD_DEFAULT_US, rate.period_us());
+    TEST_ASSERT_TRUE(run(rate, 2000, 2));
+    TEST_ASSERT_EQUAL(2000, rate.period_us());
+    TEST_ASSERT_EQUAL(500, rate.rate_hz());
+}
+
+void test_lost_frames_do_not_bias_the_period(void) {
+    // Every third, seventh or fifth frame lost. Losing every second one is
+    // indistinguishable from half the rate and is followed as such.
+    FrameRate rate;
+    run(rate, 2000, 2);
+    TEST_ASSERT_FALSE(run(rate, 2000, 300, 3));
+    TEST_ASSERT_FALSE(run(rate, 2000, 300, 7));
+    TEST_ASSERT_EQUAL(2000, rate.period_us());
+
+    FrameRate slow;
+    run(slow, 4000, 2);
+    TEST_ASSERT_FALSE(run(slow, 4000, 300, 5));
+    TEST_ASSERT_EQUAL(4000, slow.period_us());
+}
+
+void test_slower_rate_followed(void) {
+    // Every interval twice the estimate: skipped a few times, then taken as the new rate
+    FrameRate rate;
+    run(rate, 2000, 50);
+    TEST_ASSERT_FALSE(run(rate, 4000, FRAME_PERIOD_GAP_RUN - 1));
+    TEST_ASSERT_EQUAL(2000, rate.period_us());
+    TEST_ASSERT_TRUE(run(rate, 4000, 1));
+    TEST_ASSERT_EQUAL(4000, rate.period_us());
+    TEST_ASSERT_FALSE(run(rate, 4000, 100));
+    TEST_ASSERT_EQUAL(4000, rate.period_us());
+}
+
+void test_faster_rate_followed(void) {
+    FrameRate rate;
+    run(rate, 4000, 50);
+    TEST_ASSERT_TRUE(run(rate, 1000, 100));
+    TEST_ASSERT_UINT_WITHIN(1000 >> FRAME_PERIOD_RETUNE_SHIFT, 1000, rate.period_us());
+}
+
+void test_jitter_does_not_republish(void) {
+    FrameRate rate;
+    run(rate, 2000, 2);
+    bool changed = false;
+    for (uint16_t i = 0; i < 500; i++) {
+        stamp += 2000 + (i % 2 ? 60 : -60);
+        changed |= rate.frame(stamp);
+    }
+    TEST_ASSERT_FALSE(changed);
+    TEST_ASSERT_EQUAL(2000, rate.period_us());
+}
+
+void test_restart_ignores_the_gap(void) {
+    FrameRate rate;
+    run(rate, 2000, 10);
+    rate.restart();
+    stamp += 30000;
+    TEST_ASSERT_FALSE(rate.frame(stamp));
+    TEST_ASSERT_FALSE(run(rate, 2000, 50));
+    TEST_ASSERT_EQUAL(2000, rate.period_us());
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_first_interval_sets_the_period);
+    RUN_TEST(test_lost_frames_do_not_bias_the_period);
+    RUN_TEST(test_slower_rate_followed);
+    RUN_TEST(test_faster_rate_followed);
+    RUN_TEST(test_jitter_does_not_republish);
+    RUN_TEST(test_restart_ignores_the_gap);
+    return UNITY_END();
+}
@@ -0,0 +1,119 @@
+// Median sorting networks against std::nth_element, run with `pio test -e native`.
+// A compare-exchange network that sorts every 0/1 input sorts every input
+// (the 0-1 principle), so the binary inputs are checked exhaustively and
+// random channel values then cover the Median<N> ring on top.
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <stdio.h>
+#include <unity.h>
+#include "utils/FilterPipeline.h"
+
+#define RANDOM_SAMPLES 200000L
+#define BENCH_SETS 200000L
+#define BENCH_REPEATS 20
+
+static long reference_median(const long *values, uint8_t n) {
+    long sorted[7];
+    std::copy(values, values + n, sorted);
+    std::nth_element(sorted, sorted + n / 2, sorted + n);
+    return sorted[n / 2];
+}
+
+// The exchange sort Median used before the networks, kept as the benchmark baseline
+template <uint8_t N>
+static long exchange_sort_median(const long *values) {
+    long sorted[N];
+    for (uint8_t i = 0; i < N; ++i) sorted[i] = values[i];
+    for (uint8_t i = 0; i < N - 1; ++i) for (uint8_t j = i + 1; j < N; ++j) if (sorted[i] > sorted[j]) { long t = sorted[i]; sorted[i] = sorted[j]; sorted[j] = t; }
+    return sorted[N / 2];
+}
+
+template <uint8_t N>
+static void check_zero_one(void) {
+    for (uint16_t bits = 0; bits < (1u << N); bits++) {
+        long values[N];
+        for (uint8_t i = 0; i < N; i++) values[i] = (bits >> i) & 1;
+        long expected = reference_median(values, N);
+        TEST_ASSERT_EQUAL(expected, MedianNetwork<N>::select(values));
+    }
+}
+
+template <uint8_t N>
+static void check_random(void) {
+    std::mt19937 generator(N);
+    std::uniform_int_distribution<long> channel(0, SBUS_TRACKER_SAMPLE_MAX);
+    Median<N> median;
+    long history[N] = {0};
+    uint8_t head = 0;
+    for (long k = 0; k < RANDOM_SAMPLES; k++) {
+        long sample = channel(generator);
+        history[head] = sample;
+        head = (head + 1) % N;
+        TEST_ASSERT_EQUAL(reference_median(history, N), median.process(sample));
+    }
+}
+
+template <uint8_t N>
+static void bench(void) {
+    std::mt19937 generator(N);
+    std::uniform_int_distribution<long> channel(0, SBUS_TRACKER_SAMPLE_MAX);
+    static long input[BENCH_SETS * N];
+    for (long &value : input) value = channel(generator);
+
+    volatile long sink = 0;
+    auto t0 = std::chrono::steady_clock::now();
+    for (int rep = 0; rep < BENCH_REPEATS; rep++) {
+        for (long set = 0; set < BENCH_SETS; set++) {
+            long values[N];
+            std::copy(input + set * N, input + set * N + N, values);
+            sink = sink + MedianNetwork<N>::select(values);
+        }
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    for (int rep = 0; rep < BENCH_REPEATS; rep++) {
+        for (long set = 0; set < BENCH_SETS; set++) {
+            sink = sink + exchange_sort_median<N>(input + set * N);
+        }
+    }
+    auto t2 = std::chrono::steady_clock::now();
+
+    double calls = (double)BENCH_REPEATS * BENCH_SETS;
+    char line[96];
+    snprintf(line, sizeof(line), "median of %u: network %.2f ns, exchange sort %.2f ns",
+             N, std::chrono::duration<double, std::nano>(t1 - t0).count() / calls,
+             std::chrono::duration<double, std::nano>(t2 - t1).count() / calls);
+    TEST_MESSAGE(line);
+}
+
+void setUp(void) {
+}
+
+void tearDown(void) {
+}
+
+void test_zero_one_3(void) { check_zero_one<3>(); }
+void test_zero_one_5(void) { check_zero_one<5>(); }
+void test_zero_one_7(void) { check_zero_one<7>(); }
+void test_random_3(void) { check_random<3>(); }
+void test_random_5(void) { check_random<5>(); }
+void test_random_7(void) { check_random<7>(); }
+
+// Host timings only; the AVR cost is the exchange count in FilterPipeline.h
+void test_bench(void) {
+    bench<3>();
+    bench<5>();
+    bench<7>();
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_zero_one_3);
+    RUN_TEST(test_zero_one_5);
+    RUN_TEST(test_zero_one_7);
+    RUN_TEST(test_random_3);
+    RUN_TEST(test_random_5);
+    RUN_TEST(test_random_7);
+    RUN_TEST(test_bench);
+    return UNITY_END();
+}
@@ -0,0 +1,135 @@
+// USART1 baud selection and receive ring throughput, run with `pio test -e native`.
+// SBUS_UART programs the stand-in registers from test/native, so the chosen
+// divisor and U2X mode can be read back; bytes are pushed through the ISR
+// path at each rate's real byte time while a consumer drains the ring.
+#include <unity.h>
+#include <FUTABA_SBUS.h>
+
+#if F_CPU != 16000000UL
+#error the expected divisors are for a 16 MHz part
+#endif
+
+#define LOOP_PASS_US 500 // loop() pass that also sends a HID report
+#define STREAM_US 100000UL
+
+static unsigned long clock_us;
+
+unsigned long micros(void) {
+    return clock_us;
+}
+
+unsigned long millis(void) {
+    return clock_us / 1000;
+}
+
+struct BaudCase {
+    uint32_t baud;
+    bool doubleSpeed;
+    uint16_t ubrr;
+    uint32_t actual;
+};
+
+// Every rate the link is expected to run at, with the divisor it needs
+static const BaudCase supported[] = {
+    { 115200, true, 16, 117647 },
+    { 400000, true, 4, 400000 },
+    { 1000000, false, 0, 1000000 }, // exact either way, normal speed wins the tie
+    { 2000000, true, 0, 2000000 },
+};
+
+void setUp(void) {
+    clock_us = 0;
+}
+
+void tearDown(void) {
+}
+
+void test_supported_divisors(void) {
+    for (const BaudCase &c : supported) {
+        SBUS_UART::begin(c.baud);
+        TEST_ASSERT_EQUAL(c.ubrr, UBRR1);
+        TEST_ASSERT_EQUAL(c.doubleSpeed, (UCSR1A & _BV(U2X1)) != 0);
+        TEST_ASSERT_EQUAL(c.actual, SBUS_UART::actualBaud());
+        TEST_ASSERT_LESS_OR_EQUAL(SBUS_UART_BAUD_ERROR_MAX, SBUS_UART::baudError());
+        TEST_ASSERT_EQUAL(SBUS_UART::baudError(), SBUS_UART::baudErrorFor(c.baud));
+    }
+}
+
+void test_error_within_bound(void) {
+    // 115200 is the worst supported rate at 2.1%
+    TEST_ASSERT_EQUAL(21, SBUS_UART::baudErrorFor(115200));
+    TEST_ASSERT_EQUAL(0, SBUS_UART::baudErrorFor(400000));
+    TEST_ASSERT_EQUAL(0, SBUS_UART::baudErrorFor(2000000));
+}
+
+void test_unreachable_rates_rejected(void) {
+    TEST_ASSERT_GREATER_THAN(SBUS_UART_BAUD_ERROR_MAX, SBUS_UART::baudErrorFor(420000));
+    TEST_ASSERT_GREATER_THAN(SBUS_UART_BAUD_ERROR_MAX, SBUS_UART::baudErrorFor(921600));
+
+    FUTABA_SBUS sBus;
+    TEST_ASSERT_TRUE(sBus.SetBaudRate(400000));
+    TEST_ASSERT_FALSE(sBus.SetBaudRate(420000));
+    TEST_ASSERT_FALSE(sBus.SetBaudRate(921600));
+    TEST_ASSERT_FALSE(sBus.SetBaudRate(0));
+    // A rejected proposal leaves the link where it was
+    TEST_ASSERT_EQUAL(400000, sBus.BaudRate());
+    TEST_ASSERT_EQUAL(4, UBRR1);
+}
+
+// Continuous bytes at the actual rate, drained once per LOOP_PASS_US
+static void stream_at(const BaudCase &c) {
+    SBUS_UART::begin(c.baud);
+    uint16_t overflows = SBUS_UART::rxOverflows();
+    uint32_t byte_ns = 10000000000ULL / c.actual; // 8N1: ten bits per byte
+    uint32_t sent = 0;
+    uint32_t received = 0;
+    unsigned long next_pass = LOOP_PASS_US;
+    for (uint64_t t_ns = 0; t_ns < STREAM_US * 1000ULL; t_ns += byte_ns) {
+        clock_us = t_ns / 1000;
+        if (clock_us >= next_pass) {
+            uint8_t data;
+            uint16_t stamp;
+            while (SBUS_UART::read(data, stamp)) {
+                TEST_ASSERT_EQUAL((uint8_t)received, data);
+                TEST_ASSERT_EQUAL((uint16_t)(received * (uint64_t)byte_ns / 1000), stamp);
+                received++;
+            }
+            next_pass += LOOP_PASS_US;
+        }
+        SBUS_UART::receive((uint8_t)sent++, 0);
+    }
+    uint8_t data;
+    uint16_t stamp;
+    while (SBUS_UART::read(data, stamp)) {
+        received++;
+    }
+    TEST_ASSERT_EQUAL(0, SBUS_UART::rxOverflows() - overflows);
+    TEST_ASSERT_EQUAL(sent, received);
+    TEST_ASSERT_EQUAL(0, SBUS_UART::available());
+}
+
+void test_ring_keeps_up_at_supported_rates(void) {
+    for (const BaudCase &c : supported) {
+        stream_at(c);
+    }
+}
+
+void test_errors_counted(void) {
+    SBUS_UART::begin(400000);
+    uint16_t errors = SBUS_UART::rxErrors();
+    SBUS_UART::receive(0x55, _BV(FE1));
+    SBUS_UART::receive(0x55, _BV(DOR1));
+    SBUS_UART::receive(0x55, 0);
+    TEST_ASSERT_EQUAL(2, SBUS_UART::rxErrors() - errors);
+    TEST_ASSERT_EQUAL(3, SBUS_UART::available());
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_supported_divisors);
+    RUN_TEST(test_error_within_bound);
+    RUN_TEST(test_unreachable_rates_rejected);
+    RUN_TEST(test_ring_keeps_up_at_supported_rates);
+    RUN_TEST(test_errors_counted);
+    return UNITY_END();
+}
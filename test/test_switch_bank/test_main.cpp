@@ -0,0 +1,101 @@
+// SwitchDecoder and SwitchBank, run with `pio test -e native`.
+// Positions, hysteresis and the debounce time are checked through a bank
+// holding a tri-switch, a button and a slot that is not a switch.
+#include <unity.h>
+#include "utils/SwitchDecoder.h"
+
+unsigned long micros(void) {
+    return 0;
+}
+
+unsigned long millis(void) {
+    return 0;
+}
+
+#define DEBOUNCE_MS 12
+
+// UP above 1400, back below 1100; DOWN below 500, back above 800
+static const SwitchProfile triProfile = tri_switch_profile(1400, 1100, 500, 800, DEBOUNCE_MS);
+static const SwitchProfile buttonProfile = button_profile(1200, 800, DEBOUNCE_MS);
+
+enum { TRI, BUTTON, PLAIN, SLOTS };
+static const SwitchProfile *const profiles[SLOTS] = { &triProfile, &buttonProfile, NULL };
+
+// Feeds the same values for a number of frames, returns the OR of the change masks
+static uint16_t run(SwitchBank<SLOTS> &bank, long tri, long button, uint8_t frames, uint16_t period_us) {
+    long values[SLOTS] = { tri, button, 2047 };
+    uint16_t changed = 0;
+    for (uint8_t i = 0; i < frames; i++) {
+        changed |= bank.update(values, period_us);
+    }
+    return changed;
+}
+
+void setUp(void) {
+}
+
+void tearDown(void) {
+}
+
+void test_initial_positions(void) {
+    SwitchBank<SLOTS> bank(profiles);
+    TEST_ASSERT_EQUAL(MID, bank.position(TRI));
+    TEST_ASSERT_EQUAL(OFF, bank.position(BUTTON));
+    TEST_ASSERT_EQUAL(0, bank.position(PLAIN));
+}
+
+void test_debounce_follows_frame_period(void) {
+    // 12 ms is three frames at 250 Hz and six at 500 Hz
+    SwitchBank<SLOTS> bank(profiles);
+    TEST_ASSERT_EQUAL(0, run(bank, 1500, 1500, 2, 4000));
+    TEST_ASSERT_EQUAL(MID, bank.position(TRI));
+    TEST_ASSERT_EQUAL((1u << TRI) | (1u << BUTTON), run(bank, 1500, 1500, 1, 4000));
+    TEST_ASSERT_EQUAL(UP, bank.position(TRI));
+    TEST_ASSERT_EQUAL(ON, bank.position(BUTTON));
+
+    bank.reset();
+    TEST_ASSERT_EQUAL(0, run(bank, 300, 992, 5, 2000));
+    TEST_ASSERT_EQUAL(1u << TRI, run(bank, 300, 992, 1, 2000));
+    TEST_ASSERT_EQUAL(DOWN, bank.position(TRI));
+}
+
+void test_hysteresis_band_holds(void) {
+    SwitchBank<SLOTS> bank(profiles);
+    run(bank, 1500, 1500, 3, 4000);
+    // Inside the bands nothing moves, however long it lasts
+    TEST_ASSERT_EQUAL(0, run(bank, 1150, 900, 50, 4000));
+    TEST_ASSERT_EQUAL(UP, bank.position(TRI));
+    TEST_ASSERT_EQUAL(ON, bank.position(BUTTON));
+    TEST_ASSERT_EQUAL((1u << TRI) | (1u << BUTTON), run(bank, 1000, 700, 3, 4000));
+    TEST_ASSERT_EQUAL(MID, bank.position(TRI));
+    TEST_ASSERT_EQUAL(OFF, bank.position(BUTTON));
+}
+
+void test_glitch_restarts_debounce(void) {
+    SwitchBank<SLOTS> bank(profiles);
+    run(bank, 1500, 992, 2, 4000);
+    // One frame back at MID throws the two frames at UP away
+    run(bank, 992, 992, 1, 4000);
+    TEST_ASSERT_EQUAL(0, run(bank, 1500, 992, 2, 4000));
+    TEST_ASSERT_EQUAL(MID, bank.position(TRI));
+    TEST_ASSERT_EQUAL(1u << TRI, run(bank, 1500, 992, 1, 4000));
+}
+
+void test_reset_restores_initial_positions(void) {
+    SwitchBank<SLOTS> bank(profiles);
+    run(bank, 300, 1500, 3, 4000);
+    TEST_ASSERT_EQUAL(DOWN, bank.position(TRI));
+    bank.reset();
+    TEST_ASSERT_EQUAL(MID, bank.position(TRI));
+    TEST_ASSERT_EQUAL(OFF, bank.position(BUTTON));
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_initial_positions);
+    RUN_TEST(test_debounce_follows_frame_period);
+    RUN_TEST(test_hysteresis_band_holds);
+    RUN_TEST(test_glitch_restarts_debounce);
+    RUN_TEST(test_reset_restores_initial_positions);
+    return UNITY_END();
+}
@@ -0,0 +1,155 @@
+#!/usr/bin/env python3
+"""Generate src/utils/ResponseCurveTables.h, the per-axis stick response curves.
+
+Each axis gets a deadband, expo and rate. The deadband is kept in counts and the
+rest of the curve is sampled, starting at the deadband edge, into a PROGMEM
+table of RESPONSE_CURVE_POINTS output offsets from center, one every
+2**RESPONSE_CURVE_SEGMENT_SHIFT input counts, which src/utils/ResponseCurve.h
+interpolates linearly in integer math. The last segment is sampled past full
+deflection so that the input can be capped at the span exactly. The tool checks that interpolation
+against the exact curve for every input before writing the header.
+
+    python3 tools/gen_response_curves.py           # regenerate the header
+    python3 tools/gen_response_curves.py --check   # verify it is up to date
+"""
+
+import argparse
+import os
+import sys
+
+# Curve shape per axis, in normalized stick units:
+#   deadband  fraction of the half travel around center that reads as center
+#   expo      0 = linear, 1 = pure cubic (fine control near center)
+#   rate      output at full deflection, 1 = full scale
+# The defaults are identity curves, so the sticks report exactly what they did
+# before shaping existed; set an axis's values here to opt in, e.g.
+#   'X': dict(deadband=0.02, expo=0.3, rate=1.0),
+AXES = {
+    'X': dict(deadband=0.0, expo=0.0, rate=1.0),
+    'Y': dict(deadband=0.0, expo=0.0, rate=1.0),
+    'Rx': dict(deadband=0.0, expo=0.0, rate=1.0),
+    'Ry': dict(deadband=0.0, expo=0.0, rate=1.0),
+}
+
+CENTER = 992       # CALIBRATION_OUT_CENTER
+HALF_SPAN = 819    # CALIBRATION_OUT_HIGH - CALIBRATION_OUT_CENTER
+SEGMENT_SHIFT = 5  # 32 input counts per table segment
+POINTS = 27        # covers offsets 0..832 past the deadband, at least HALF_SPAN
+MAX_ERROR = 2      # counts, interpolated vs exact
+
+HEADER = os.path.join(os.path.dirname(os.path.abspath(__file__)),
+                      '..', 'src', 'utils', 'ResponseCurveTables.h')
+
+
+def deadband_counts(params):
+    return int(round(params['deadband'] * HALF_SPAN))
+
+
+def curve(offset, deadband_counts, expo, rate, clamp=True):
+    """Exact output offset from center for an input offset >= 0, in counts."""
+    if offset <= deadband_counts:
+        return 0.0
+    v = (offset - deadband_counts) / (HALF_SPAN - deadband_counts)
+    if clamp:
+        v = min(v, 1.0)
+    return HALF_SPAN * rate * (expo * v ** 3 + (1.0 - expo) * v)
+
+
+def exact(params, clamp=True):
+    deadband = deadband_counts(params)
+    return lambda offset: curve(offset, deadband, params['expo'], params['rate'], clamp)
+
+
+def table(params):
+    deadband = deadband_counts(params)
+    f = exact(params, clamp=False)
+    # Only points up to the one after full deflection are ever read, the rest
+    # repeat it so the table stays monotonic and in range
+    last = min(((HALF_SPAN - deadband) >> SEGMENT_SHIFT) + 1, POINTS - 1)
+    points = [int(round(f(deadband + (i << SEGMENT_SHIFT)))) for i in range(last + 1)]
+    return points + [points[-1]] * (POINTS - 1 - last)
+
+
+def interpolate(deadband, points, offset):
+    """Same integer math as response_curve() in ResponseCurve.h."""
+    if offset <= deadband:
+        return 0
+    offset = min(offset, HALF_SPAN) - deadband
+    index = offset >> SEGMENT_SHIFT
+    frac = offset & ((1 << SEGMENT_SHIFT) - 1)
+    return points[index] + (((points[index + 1] - points[index]) * frac) >> SEGMENT_SHIFT)
+
+
+def verify(name, params, points):
+    deadband = deadband_counts(params)
+    f = exact(params)
+    worst = 0
+    for offset in range(2048 - CENTER):
+        error = abs(interpolate(deadband, points, offset) - f(offset))
+        worst = max(worst, error)
+    if worst > MAX_ERROR:
+        sys.exit('%s: interpolation error %.2f counts exceeds %d' % (name, worst, MAX_ERROR))
+    if any(b < a for a, b in zip(points, points[1:])):
+        sys.exit('%s: curve is not monotonic' % name)
+    if (HALF_SPAN - deadband) >> SEGMENT_SHIFT >= POINTS - 1:
+        sys.exit('%s: table too short for the span' % name)
+    if points[-1] > 2047 - CENTER:
+        sys.exit('%s: curve leaves the 11-bit range' % name)
+    return worst
+
+
+def render(tables):
+    lines = [
+        '// ResponseCurveTables.h',
+        '// Generated by tools/gen_response_curves.py, do not edit by hand.',
+        '#ifndef RESPONSE_CURVE_TABLES_H',
+        '#define RESPONSE_CURVE_TABLES_H',
+        '',
+        '#include "ResponseCurve.h"',
+        '',
+        '#if RESPONSE_CURVE_CENTER != %d || RESPONSE_CURVE_HALF_SPAN != %d \\' % (CENTER, HALF_SPAN),
+        '    || RESPONSE_CURVE_SEGMENT_SHIFT != %d || RESPONSE_CURVE_POINTS != %d' % (SEGMENT_SHIFT, POINTS),
+        '#error ResponseCurve.h does not match tools/gen_response_curves.py, regenerate the tables',
+        '#endif',
+        '',
+    ]
+    for name, params, points in tables:
+        lines.append('// %s: deadband %.2f, expo %.2f, rate %.2f' %
+                     (name, params['deadband'], params['expo'], params['rate']))
+        lines.append('static const ResponseCurve responseCurve%s PROGMEM = { %d, {' % (name, deadband_counts(params)))
+        for start in range(0, POINTS, 11):
+            row = ', '.join('%4d' % p for p in points[start:start + 11])
+            lines.append('    %s,' % row)
+        lines.append('} };')
+        lines.append('')
+    lines.append('#endif')
+    return '\n'.join(lines) + '\n'
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('--check', action='store_true',
+                        help='fail if the header differs from what would be generated')
+    args = parser.parse_args()
+
+    tables = []
+    for name, params in AXES.items():
+        points = table(params)
+        worst = verify(name, params, points)
+        print('%-3s max interpolation error %.2f counts' % (name, worst))
+        tables.append((name, params, points))
+
+    text = render(tables)
+    if args.check:
+        with open(HEADER) as f:
+            if f.read() != text:
+                sys.exit('%s is out of date, run %s' % (os.path.relpath(HEADER), sys.argv[0]))
+        print('up to date')
+        return
+    with open(HEADER, 'w') as f:
+        f.write(text)
+    print('wrote %s' % os.path.relpath(HEADER))
+
+
+if __name__ == '__main__':
+    main()